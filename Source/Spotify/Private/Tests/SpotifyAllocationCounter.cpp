@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyAllocationCounter.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	thread_local uint64 ThreadAllocations = 0;
+
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+
+		virtual const TCHAR* GetDescriptiveName() override { return TEXT("SpotifyAllocationCounter"); }
+
+		FMalloc* Inner;
+	};
+
+	// Never deleted, a thread may still be inside it when it is uninstalled.
+	FCountingMalloc* Counter = nullptr;
+}
+
+void FSpotifyAllocationCounter::InstallIfRequested()
+{
+	if(Counter || !GMalloc || !FParse::Param(FCommandLine::Get(), TEXT("SpotifyCountAllocations"))) return;
+
+	Counter = new FCountingMalloc(GMalloc);
+	GMalloc = Counter;
+}
+
+void FSpotifyAllocationCounter::Uninstall()
+{
+	if(Counter && GMalloc == Counter)
+	{
+		GMalloc = Counter->Inner;
+	}
+}
+
+bool FSpotifyAllocationCounter::IsInstalled()
+{
+	return Counter && GMalloc == Counter;
+}
+
+uint64 FSpotifyAllocationCounter::GetThreadAllocations()
+{
+	return ThreadAllocations;
+}
+
+#endif
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Counts every thread's allocations for the allocation tests. Swapping GMalloc under running tests races with the
+ * worker threads, so the counter is only installed when the module starts up with -SpotifyCountAllocations and stays
+ * in place until the module shuts down. It forwards everything to the allocator it wraps, so memory allocated before
+ * it was installed is freed correctly.
+ */
+class FSpotifyAllocationCounter
+{
+public:
+
+	static void InstallIfRequested();
+
+	static void Uninstall();
+
+	static bool IsInstalled();
+
+	// Allocations and reallocations the calling thread made since the counter was installed.
+	static uint64 GetThreadAllocations();
+};
+
+#endif
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyConnectionWarmer.h"
+#include "SpotifyRequestTemplate.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The pings go to a recorder instead of the HTTP module, nothing leaves the machine.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyConnectionWarmerTest, "Spotify.ConnectionWarmer.Tick",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyConnectionWarmerTest::RunTest(const FString& Parameters)
+{
+	FSpotifyRequestTemplates Templates;
+	Templates.Build(TEXT("https://api.spotify.test/v1"), TEXT("https://accounts.spotify.test/api"));
+	const FString Api = TEXT("https://api.spotify.test/");
+	const FString Accounts = TEXT("https://accounts.spotify.test/");
+
+	TArray<FString> Pings;
+	const auto Record = [&Pings](const FString& Url) { Pings.Add(Url); };
+
+	FSpotifyConnectionWarmer Warmer;
+	TestFalse(TEXT("Disabled by default"), Warmer.IsEnabled());
+	Warmer.SetInterval(30.0);
+	TestTrue(TEXT("Enabled"), Warmer.IsEnabled());
+
+	// Pre-warming opens both hosts, built from the templates' origins.
+	Warmer.WarmAll(Templates, 0.0, Record);
+	TestEqual(TEXT("Pre-warmed"), Pings, TArray<FString>{Api, Accounts});
+	TestEqual(TEXT("Warmups after pre-warming"), Warmer.GetWarmups(), 2);
+
+	// Nobody playing: nothing is pinged however long it has been, it checks back after the idle interval.
+	Pings.Reset();
+	TestEqual(TEXT("Idle interval while nobody plays"), Warmer.Tick(Templates, 100.0, false, Record), 30.0);
+	TestEqual(TEXT("No pings while nobody plays"), Pings.Num(), 0);
+
+	// Someone playing: every host idle for the interval is pinged.
+	TestEqual(TEXT("Next check after pinging all"), Warmer.Tick(Templates, 100.0, true, Record), 30.0);
+	TestEqual(TEXT("Both idle hosts pinged"), Pings, TArray<FString>{Api, Accounts});
+
+	// Regular traffic keeps a host warm by itself, only the other one is pinged.
+	Pings.Reset();
+	Warmer.Touch(Templates.Get(ESpotifyEndpoint::Play).Host, 120.0);
+	TestEqual(TEXT("Next check when the api goes idle"), Warmer.Tick(Templates, 130.0, true, Record), 20.0);
+	TestEqual(TEXT("Only the idle host pinged"), Pings, TArray<FString>{Accounts});
+
+	// Nothing idle yet.
+	Pings.Reset();
+	Warmer.Touch(Templates.Get(ESpotifyEndpoint::Token).Host, 135.0);
+	TestEqual(TEXT("Next check when the first host goes idle"), Warmer.Tick(Templates, 140.0, true, Record), 10.0);
+	TestEqual(TEXT("Nothing pinged"), Pings.Num(), 0);
+	TestEqual(TEXT("Warmups"), Warmer.GetWarmups(), 5);
+
+	// A host without a url is never pinged.
+	FSpotifyRequestTemplates ApiOnly;
+	ApiOnly.Build(TEXT("https://api.spotify.test/v1"), FString());
+	FSpotifyConnectionWarmer ApiOnlyWarmer;
+	ApiOnlyWarmer.SetInterval(30.0);
+	Pings.Reset();
+	ApiOnlyWarmer.Tick(ApiOnly, 100.0, true, Record);
+	TestEqual(TEXT("Only hosts with a url pinged"), Pings, TArray<FString>{Api});
+	return true;
+}
+
+#endif
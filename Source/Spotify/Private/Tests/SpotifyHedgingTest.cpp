@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyHedging.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyLatencyTrackerTest, "Spotify.Hedging.LatencyTracker",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyLatencyTrackerTest::RunTest(const FString& Parameters)
+{
+	FSpotifyLatencyTracker Tracker;
+	TestEqual(TEXT("Empty"), Tracker.GetPercentile(0.95), 0.0);
+
+	// Added out of order, the percentiles are nearest rank.
+	for(int32 Index = 0; Index < 100; Index++)
+	{
+		Tracker.Add(((Index * 37) % 100 + 1) / 1000.0);
+	}
+	TestEqual(TEXT("Samples"), Tracker.Num(), 100);
+	TestEqual(TEXT("p50"), Tracker.GetPercentile(0.5), 0.050);
+	TestEqual(TEXT("p95"), Tracker.GetPercentile(0.95), 0.095);
+	TestEqual(TEXT("p99"), Tracker.GetPercentile(0.99), 0.099);
+	TestEqual(TEXT("Min"), Tracker.GetPercentile(0.0), 0.001);
+	TestEqual(TEXT("Max"), Tracker.GetPercentile(1.0), 0.100);
+
+	// Only the newest 256 samples count.
+	for(int32 Index = 101; Index <= 400; Index++)
+	{
+		Tracker.Add(Index / 1000.0);
+	}
+	TestEqual(TEXT("Capped"), Tracker.Num(), 256);
+	TestEqual(TEXT("Oldest kept"), Tracker.GetPercentile(0.0), 0.145);
+	TestEqual(TEXT("Newest"), Tracker.GetPercentile(1.0), 0.400);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyHedgePolicyTest, "Spotify.Hedging.Policy",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyHedgePolicyTest::RunTest(const FString& Parameters)
+{
+	FSpotifyHedgePolicy Policy(0.5f);
+
+	// No hedging until 16 polls were timed.
+	for(int32 Index = 1; Index <= 16; Index++)
+	{
+		TestTrue(TEXT("Warming up"), Policy.OnRequestSent() < 0.0);
+		Policy.OnCompleted(Index / 100.0, false);
+	}
+	TestEqual(TEXT("Hedged at the p95"), Policy.OnRequestSent(), 0.16);
+	Policy.OnCompleted(0.17, false);
+
+	// Each request earns half a hedge, unused budget is capped at two.
+	TestTrue(TEXT("Banked hedge"), Policy.TryHedge());
+	TestTrue(TEXT("Second banked hedge"), Policy.TryHedge());
+	TestFalse(TEXT("Budget used up"), Policy.TryHedge());
+	Policy.OnRequestSent();
+	TestFalse(TEXT("Half a hedge"), Policy.TryHedge());
+	Policy.OnRequestSent();
+	TestTrue(TEXT("Refilled"), Policy.TryHedge());
+	Policy.OnCompleted(0.30, true);
+	Policy.OnCompleted(0.05, false);
+
+	const FSpotifyHedgeStats Stats = Policy.GetStats();
+	TestEqual(TEXT("Requests"), Stats.Requests, 19);
+	TestEqual(TEXT("Hedges"), Stats.Hedges, 3);
+	TestEqual(TEXT("Hedge wins"), Stats.HedgeWins, 1);
+	TestEqual(TEXT("Hedge rate"), Stats.HedgeRate, 3.f / 19.f);
+	TestEqual(TEXT("Delay"), Stats.HedgeDelayMs, float(Policy.GetHedgeDelay() * 1000.0));
+
+	// Fast polls still wait a little before hedging.
+	FSpotifyHedgePolicy Fast(0.5f);
+	for(int32 Index = 0; Index < 16; Index++)
+	{
+		Fast.OnRequestSent();
+		Fast.OnCompleted(0.001, false);
+	}
+	TestEqual(TEXT("Minimum delay"), Fast.OnRequestSent(), 0.05);
+
+	// A budget of 0 turns hedging off.
+	Fast.SetBudgetRatio(0.f);
+	TestTrue(TEXT("Disabled"), Fast.OnRequestSent() < 0.0);
+	return true;
+}
+
+// Polls against a latency distribution with a long tail (true p95 about 1.6s), hedged whenever the policy says so.
+// A poll the hedge won must still count as slow, otherwise the p95 only sees the fast side of every race and sinks
+// until most polls are hedged.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyHedgePolicyDriftTest, "Spotify.Hedging.Drift",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyHedgePolicyDriftTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(30);
+	auto SampleLatency = [&Random]()
+	{
+		return Random.FRand() < 0.8f ? 0.1 + 0.1 * Random.FRand() : 0.5 + 1.5 * Random.FRand();
+	};
+
+	// Budget for a hedge on every poll, so only the delay limits them.
+	FSpotifyHedgePolicy Policy(1.f);
+	for(int32 Poll = 0; Poll < 5000; Poll++)
+	{
+		const double Delay = Policy.OnRequestSent();
+		const double Latency = SampleLatency();
+		if(Delay >= 0.0 && Latency > Delay && Policy.TryHedge())
+		{
+			const double HedgeAnswer = Delay + SampleLatency();
+			Policy.OnCompleted(FMath::Min(Latency, HedgeAnswer), HedgeAnswer < Latency);
+		}
+		else
+		{
+			Policy.OnCompleted(Latency, false);
+		}
+	}
+
+	const FSpotifyHedgeStats Stats = Policy.GetStats();
+	AddInfo(FString::Printf(TEXT("Hedge delay %.0f ms, hedge rate %.3f"), Stats.HedgeDelayMs, Stats.HedgeRate));
+	TestTrue(TEXT("Delay stays at the tail"), Stats.HedgeDelayMs > 1000.f && Stats.HedgeDelayMs < 2000.f);
+	TestTrue(TEXT("About one poll in twenty is hedged"), Stats.HedgeRate < 0.08f);
+	return true;
+}
+
+#endif
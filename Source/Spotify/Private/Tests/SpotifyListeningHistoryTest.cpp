@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyListeningHistory.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SpotifyListeningHistoryTest
+{
+	struct FPlay
+	{
+		int64 TimeMs;
+		int32 ListenedMs;
+		int32 Song;
+		bool bSkipped;
+	};
+
+	constexpr int64 MsPerHour = 60 * 60 * 1000;
+
+	FString SongId(int32 Song) { return FString::Printf(TEXT("song%03d"), Song); }
+	FString SongName(int32 Song) { return FString::Printf(TEXT("Song %d"), Song); }
+	FString Artist(int32 Song) { return FString::Printf(TEXT("Artist %d"), Song % 7); }
+
+	// Expected answers, added up from the plays themselves.
+	struct FExpected
+	{
+		int64 ListenedMs = 0;
+		int32 Plays = 0;
+		int32 Skips = 0;
+		TMap<FString, int64> ArtistMs;
+	};
+
+	FExpected Count(const TArray<FPlay>& Plays, const FDateTime& From, const FDateTime& To)
+	{
+		// Queries round the window out to whole hours.
+		const int64 FromMs = FSpotifyListeningHistory::ToUnixMs(From) / MsPerHour * MsPerHour;
+		const int64 ToMs = (FSpotifyListeningHistory::ToUnixMs(To) + MsPerHour - 1) / MsPerHour * MsPerHour;
+		FExpected Expected;
+		for(const FPlay& Play : Plays)
+		{
+			if(Play.TimeMs < FromMs || Play.TimeMs >= ToMs) continue;
+			Expected.ListenedMs += Play.ListenedMs;
+			Expected.Plays++;
+			Expected.Skips += Play.bSkipped ? 1 : 0;
+			Expected.ArtistMs.FindOrAdd(Artist(Play.Song)) += Play.ListenedMs;
+		}
+		return Expected;
+	}
+
+	void CheckWindow(FAutomationTestBase& Test, const FSpotifyListeningHistory& History, const TArray<FPlay>& Plays,
+		const FDateTime& From, const FDateTime& To, const FString& What)
+	{
+		const FExpected Expected = Count(Plays, From, To);
+		Test.TestEqual(What + TEXT(" listening seconds"), History.GetListeningSeconds(From, To), Expected.ListenedMs / 1000.0);
+		Test.TestEqual(What + TEXT(" skip rate"), History.GetSkipRate(From, To), Expected.Plays > 0 ? float(Expected.Skips) / Expected.Plays : 0.f);
+
+		const TArray<FSpotifyHistoryEntry> Artists = History.GetTopArtists(From, To, 100);
+		Test.TestEqual(What + TEXT(" artist count"), Artists.Num(), Expected.ArtistMs.Num());
+		for(int32 Index = 0; Index < Artists.Num(); Index++)
+		{
+			const int64* ListenedMs = Expected.ArtistMs.Find(Artists[Index].Name);
+			Test.TestTrue(What + TEXT(" known artist"), ListenedMs != nullptr);
+			Test.TestEqual(What + TEXT(" artist seconds"), Artists[Index].ListenedSeconds, ListenedMs ? *ListenedMs / 1000.f : 0.f);
+			Test.TestTrue(What + TEXT(" artists sorted"), Index == 0 || Artists[Index - 1].ListenedSeconds >= Artists[Index].ListenedSeconds);
+		}
+	}
+}
+
+// Enough plays for several segments, the answers must be the same before and after reopening.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyListeningHistoryRoundTripTest, "Spotify.ListeningHistory.RoundTrip",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyListeningHistoryRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyListeningHistoryTest;
+	const FString Directory = FPaths::AutomationTransientDir() / TEXT("SpotifyListeningHistory");
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	const FDateTime Start(2024, 3, 1);
+	const int64 StartMs = FSpotifyListeningHistory::ToUnixMs(Start);
+	FRandomStream Random(33);
+	TArray<FPlay> Plays;
+	for(int32 Index = 0; Index < 20000; Index++)
+	{
+		// A play every 3 minutes or so, about 40 days.
+		const int64 TimeMs = (Plays.Num() > 0 ? Plays.Last().TimeMs : StartMs) + Random.RandRange(60, 300) * 1000;
+		Plays.Add({TimeMs, Random.RandRange(1000, 240000), Random.RandRange(0, 199), Random.FRand() < 0.25f});
+	}
+
+	{
+		FSpotifyListeningHistory History;
+		TestTrue(TEXT("Opened"), History.Open(Directory));
+		for(const FPlay& Play : Plays)
+		{
+			History.RecordTrack(Play.TimeMs, SongId(Play.Song), SongName(Play.Song), Artist(Play.Song), Play.bSkipped);
+			History.RecordSpan(Play.TimeMs, Play.ListenedMs, SongId(Play.Song), SongName(Play.Song), Artist(Play.Song));
+		}
+
+		TArray<FString> Segments;
+		IFileManager::Get().FindFiles(Segments, *(Directory / TEXT("segment_*.bin")), true, false);
+		TestTrue(TEXT("Rotated into several segments"), Segments.Num() > 2);
+
+		CheckWindow(*this, History, Plays, Start, Start + FTimespan::FromDays(60), TEXT("Everything"));
+		CheckWindow(*this, History, Plays, Start + FTimespan::FromHours(100.5), Start + FTimespan::FromHours(700.2), TEXT("Partial"));
+	}
+
+	FSpotifyListeningHistory Reopened;
+	TestTrue(TEXT("Reopened"), Reopened.Open(Directory));
+	CheckWindow(*this, Reopened, Plays, Start, Start + FTimespan::FromDays(60), TEXT("Reopened everything"));
+	CheckWindow(*this, Reopened, Plays, Start + FTimespan::FromHours(100.5), Start + FTimespan::FromHours(700.2), TEXT("Reopened partial"));
+	CheckWindow(*this, Reopened, Plays, Start + FTimespan::FromHours(3), Start + FTimespan::FromHours(4), TEXT("One hour"));
+
+	// Appending after a reopen continues the newest segment with its name table.
+	const int64 LateMs = Plays.Last().TimeMs + MsPerHour;
+	Reopened.RecordTrack(LateMs, SongId(5), SongName(5), Artist(5), false);
+	Reopened.RecordSpan(LateMs, 30000, SongId(5), SongName(5), Artist(5));
+	Plays.Add({LateMs, 30000, 5, false});
+	Reopened.Close();
+	TestTrue(TEXT("Reopened again"), Reopened.Open(Directory));
+	CheckWindow(*this, Reopened, Plays, Start, Start + FTimespan::FromDays(60), TEXT("Appended"));
+
+	const TArray<FSpotifyHistoryEntry> Top = Reopened.GetTopTracks(Start, Start + FTimespan::FromDays(60), 3);
+	TestEqual(TEXT("Top count"), Top.Num(), 3);
+	for(const FSpotifyHistoryEntry& Entry : Top)
+	{
+		int32 Song = INDEX_NONE;
+		LexFromString(Song, *Entry.Id.RightChop(4));
+		TestEqual(TEXT("Top id and name match"), Entry.Name, SongName(Song));
+	}
+
+	Reopened.Close();
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	return true;
+}
+
+#endif
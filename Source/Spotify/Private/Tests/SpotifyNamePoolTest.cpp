@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyNamePool.h"
+#include "SpotifyService.h"
+#include "SpotifyAllocationCounter.h"
+#include "Dom/JsonObject.h"
+#include "Engine/GameInstance.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyNamePoolInternTest, "Spotify.NamePool.Intern",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyNamePoolInternTest::RunTest(const FString& Parameters)
+{
+	FSpotifyNamePool Pool(16);
+
+	FSpotifyNameHandle First = Pool.Intern(TEXT("Daft Punk"));
+	FSpotifyNameHandle Second = Pool.Intern(TEXT("Daft Punk"));
+	FSpotifyNameHandle Other = Pool.Intern(TEXT("Justice"));
+	TestTrue(TEXT("Same value, same handle"), First == Second);
+	TestTrue(TEXT("Different value, different handle"), First != Other);
+	TestEqual(TEXT("Resolves"), Pool.Get(First), FString(TEXT("Daft Punk")));
+	TestEqual(TEXT("Invalid handles resolve to empty"), Pool.Get(FSpotifyNameHandle()), FString());
+	TestEqual(TEXT("One miss per new value"), Pool.GetMisses(), uint64(2));
+	TestEqual(TEXT("Hit"), Pool.GetHits(), uint64(1));
+
+	// Assign only reports a change if the value differs.
+	FSpotifyNameHandle Assigned;
+	TestTrue(TEXT("First assign changes"), Pool.Assign(Assigned, TEXT("Justice")));
+	TestTrue(TEXT("Assign shares the entry"), Assigned == Other);
+	TestFalse(TEXT("Same value is no change"), Pool.Assign(Assigned, TEXT("Justice")));
+	TestTrue(TEXT("New value is a change"), Pool.Assign(Assigned, TEXT("Air")));
+	TestEqual(TEXT("Assigned value"), Pool.Get(Assigned), FString(TEXT("Air")));
+
+	Pool.Release(First);
+	TestFalse(TEXT("Release invalidates"), First.IsValid());
+	TestEqual(TEXT("Still referenced by Second"), Pool.Get(Second), FString(TEXT("Daft Punk")));
+
+	Pool.Reset();
+	TestEqual(TEXT("Reset empties"), Pool.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyNamePoolEvictionTest, "Spotify.NamePool.Eviction",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyNamePoolEvictionTest::RunTest(const FString& Parameters)
+{
+	FSpotifyNamePool Pool(4);
+
+	// Referenced names survive, unreferenced ones are recycled once the pool is full.
+	FSpotifyNameHandle Kept = Pool.Intern(TEXT("Kept"));
+	for(int32 Index = 0; Index < 100; Index++)
+	{
+		FSpotifyNameHandle Handle = Pool.Intern(FString::Printf(TEXT("Song %d"), Index));
+		Pool.Release(Handle);
+	}
+	TestEqual(TEXT("Bounded"), Pool.Num(), 4);
+	TestEqual(TEXT("Referenced name kept"), Pool.Get(Kept), FString(TEXT("Kept")));
+
+	// An unreferenced name that wasn't recycled yet resolves without a miss.
+	const uint64 Misses = Pool.GetMisses();
+	FSpotifyNameHandle Recent = Pool.Intern(TEXT("Song 99"));
+	TestEqual(TEXT("Cached after release"), Pool.GetMisses(), Misses);
+	TestEqual(TEXT("Recent"), Pool.Get(Recent), FString(TEXT("Song 99")));
+	TestFalse(TEXT("Distinct from the kept name"), Recent == Kept);
+	return true;
+}
+
+namespace SpotifyNamePoolTest
+{
+	// The parts of a /me/player answer the service reads.
+	TSharedRef<FJsonObject> MakePlayback(int32 ProgressMs)
+	{
+		const TSharedRef<FJsonObject> Artist = MakeShared<FJsonObject>();
+		Artist->SetStringField(TEXT("name"), TEXT("Artist"));
+
+		const TSharedRef<FJsonObject> Album = MakeShared<FJsonObject>();
+		Album->SetStringField(TEXT("name"), TEXT("Album"));
+		Album->SetArrayField(TEXT("images"), TArray<TSharedPtr<FJsonValue>>());
+
+		const TSharedRef<FJsonObject> Item = MakeShared<FJsonObject>();
+		Item->SetStringField(TEXT("id"), TEXT("4uLU6hMCjMI75M1A2tKUQC"));
+		Item->SetStringField(TEXT("name"), TEXT("Song"));
+		Item->SetNumberField(TEXT("duration_ms"), 200000);
+		Item->SetArrayField(TEXT("artists"), {MakeShared<FJsonValueObject>(Artist)});
+		Item->SetObjectField(TEXT("album"), Album);
+
+		const TSharedRef<FJsonObject> Device = MakeShared<FJsonObject>();
+		Device->SetNumberField(TEXT("volume_percent"), 50);
+
+		const TSharedRef<FJsonObject> Playback = MakeShared<FJsonObject>();
+		Playback->SetNumberField(TEXT("progress_ms"), ProgressMs);
+		Playback->SetBoolField(TEXT("is_playing"), true);
+		Playback->SetObjectField(TEXT("device"), Device);
+		Playback->SetObjectField(TEXT("item"), Item);
+		return Playback;
+	}
+}
+
+// What the game thread does with a decoded poll of an unchanged song must not allocate (the JSON itself is
+// decoded on a worker). Needs the allocation counter, run with -SpotifyCountAllocations.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyPollAllocationTest, "Spotify.NamePool.PollAllocations",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyPollAllocationTest::RunTest(const FString& Parameters)
+{
+	if(!FSpotifyAllocationCounter::IsInstalled())
+	{
+		AddWarning(TEXT("Allocations are only counted with -SpotifyCountAllocations on the command line, skipped."));
+		return true;
+	}
+
+	UGameInstance* GameInstance = NewObject<UGameInstance>(GetTransientPackage());
+	USpotifyService* Service = NewObject<USpotifyService>(GameInstance);
+	const FName Account(TEXT("Test"));
+	Service->AddTestAccount(Account);
+	Service->SetActiveAccount(Account);
+
+	const TSharedRef<FJsonObject> Polls[] = {SpotifyNamePoolTest::MakePlayback(1000), SpotifyNamePoolTest::MakePlayback(2000)};
+
+	// The song change interns the names and grows the work queue, the next poll is the steady state.
+	Service->ApplyTestPlayback(0, *Polls[0]);
+	Service->FlushWork();
+	Service->ApplyTestPlayback(0, *Polls[1]);
+	Service->FlushWork();
+
+	// Only this thread's allocations count, whatever the workers do meanwhile.
+	uint64 Allocations = 0;
+	for(int32 Poll = 0; Poll < 100; Poll++)
+	{
+		const uint64 Before = FSpotifyAllocationCounter::GetThreadAllocations();
+		Service->ApplyTestPlayback(0, *Polls[Poll % 2]);
+		Allocations += FSpotifyAllocationCounter::GetThreadAllocations() - Before;
+		Service->FlushWork();
+	}
+
+	TestEqual(TEXT("Allocations in 100 unchanged polls"), Allocations, uint64(0));
+	TestEqual(TEXT("Song unchanged"), Service->GetSongName(), FString(TEXT("Song")));
+
+	Service->MarkAsGarbage();
+	GameInstance->MarkAsGarbage();
+	return true;
+}
+
+#endif
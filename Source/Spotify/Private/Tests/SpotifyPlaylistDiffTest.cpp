@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyPlaylistDiff.h"
+#include "Algo/Reverse.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SpotifyPlaylistDiffTest
+{
+	TArray<FString> MakeTracks(int32 Num, int32 First = 0)
+	{
+		TArray<FString> Tracks;
+		for(int32 Index = First; Index < First + Num; Index++)
+		{
+			Tracks.Add(FString::Printf(TEXT("spotify:track:%d"), Index));
+		}
+		return Tracks;
+	}
+
+	// Plays the edit script against Playlist the way Spotify applies it, false if a request would be rejected.
+	bool Apply(FAutomationTestBase& Test, TArray<FString>& Playlist, const TArray<FSpotifyPlaylistMutation>& Mutations)
+	{
+		for(const FSpotifyPlaylistMutation& Mutation : Mutations)
+		{
+			if(Mutation.Uris.Num() > FSpotifyPlaylistDiff::MaxUrisPerRequest)
+			{
+				Test.AddError(TEXT("Mutation exceeds the uris per request"));
+				return false;
+			}
+			switch(Mutation.Op)
+			{
+			case ESpotifyPlaylistOp::Remove:
+				for(int32 i = 0; i < Mutation.Uris.Num(); i++)
+				{
+					const int32 Position = Mutation.Positions[i];
+					if(Mutation.Uris[i].IsEmpty() || !Playlist.IsValidIndex(Position) || Playlist[Position] != Mutation.Uris[i])
+					{
+						Test.AddError(FString::Printf(TEXT("Invalid remove of '%s' at %d"), *Mutation.Uris[i], Position));
+						return false;
+					}
+					Playlist.RemoveAt(Position);
+				}
+				break;
+			case ESpotifyPlaylistOp::Reorder:
+			{
+				if(Mutation.RangeStart < 0 || Mutation.RangeLength < 1 || Mutation.RangeStart + Mutation.RangeLength > Playlist.Num()
+					|| Mutation.InsertBefore < 0 || Mutation.InsertBefore > Playlist.Num())
+				{
+					Test.AddError(TEXT("Invalid reorder"));
+					return false;
+				}
+				const TArray<FString> Range(Playlist.GetData() + Mutation.RangeStart, Mutation.RangeLength);
+				Playlist.RemoveAt(Mutation.RangeStart, Mutation.RangeLength);
+				Playlist.Insert(Range, Mutation.InsertBefore > Mutation.RangeStart ? Mutation.InsertBefore - Mutation.RangeLength : Mutation.InsertBefore);
+				break;
+			}
+			case ESpotifyPlaylistOp::Add:
+				if(Mutation.Position < 0 || Mutation.Position > Playlist.Num())
+				{
+					Test.AddError(TEXT("Invalid add"));
+					return false;
+				}
+				Playlist.Insert(Mutation.Uris, Mutation.Position);
+				break;
+			case ESpotifyPlaylistOp::Replace:
+				Playlist = Mutation.Uris;
+				break;
+			}
+		}
+		return true;
+	}
+
+	// Diffs Current against Target, checks the script produces Target and returns how many requests it takes.
+	int32 Check(FAutomationTestBase& Test, const TCHAR* What, const TArray<FString>& Current, const TArray<FString>& Target)
+	{
+		const TArray<FSpotifyPlaylistMutation> Mutations = FSpotifyPlaylistDiff::Compute(Current, Target);
+		TArray<FString> Playlist = Current;
+		if(Apply(Test, Playlist, Mutations))
+		{
+			Test.TestTrue(What, Playlist == Target);
+		}
+		return Mutations.Num();
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyPlaylistDiffEditTest, "Spotify.PlaylistDiff.Edits",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyPlaylistDiffEditTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyPlaylistDiffTest;
+
+	const TArray<FString> Tracks = MakeTracks(10);
+	TestEqual(TEXT("Identical lists need no requests"), Check(*this, TEXT("Identical"), Tracks, Tracks), 0);
+
+	TArray<FString> Appended = Tracks;
+	Appended.Append(MakeTracks(3, 100));
+	TestEqual(TEXT("Appending is one add"), Check(*this, TEXT("Appended"), Tracks, Appended), 1);
+
+	TArray<FString> Removed = Tracks;
+	Removed.RemoveAt(7);
+	Removed.RemoveAt(2);
+	TestEqual(TEXT("Removing is one request"), Check(*this, TEXT("Removed"), Tracks, Removed), 1);
+
+	TArray<FString> Moved = Tracks;
+	Moved.RemoveAt(8);
+	Moved.Insert(Tracks[8], 1);
+	TestEqual(TEXT("Moving one track is one reorder"), Check(*this, TEXT("Moved"), Tracks, Moved), 1);
+
+	// Duplicates keep as many copies as the target has.
+	TArray<FString> Duplicates = Tracks;
+	Duplicates.Add(Tracks[3]);
+	Duplicates.Insert(Tracks[5], 0);
+	Check(*this, TEXT("Duplicates added"), Tracks, Duplicates);
+	Check(*this, TEXT("Duplicates removed"), Duplicates, Tracks);
+
+	Check(*this, TEXT("Emptied"), Tracks, TArray<FString>());
+	Check(*this, TEXT("Filled"), TArray<FString>(), Tracks);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyPlaylistDiffLargeTest, "Spotify.PlaylistDiff.Large",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyPlaylistDiffLargeTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyPlaylistDiffTest;
+
+	const TArray<FString> Tracks = MakeTracks(2000);
+
+	// Moving a block of 500 tracks to the front is a single reorder.
+	TArray<FString> Rotated(Tracks.GetData() + 1500, 500);
+	Rotated.Append(Tracks.GetData(), 1500);
+	TestEqual(TEXT("Rotating is one reorder"), Check(*this, TEXT("Rotated"), Tracks, Rotated), 1);
+
+	// Nothing stays in order, the rewrite is cheaper: one replace plus an add per further 100 tracks.
+	TArray<FString> Reversed = Tracks;
+	Algo::Reverse(Reversed);
+	TestEqual(TEXT("Reversing falls back to a rewrite"), Check(*this, TEXT("Reversed"), Tracks, Reversed), 20);
+
+	// Removals and additions are batched by 100.
+	TArray<FString> Replaced(Tracks.GetData(), 1000);
+	Replaced.Append(MakeTracks(250, 5000));
+	TestEqual(TEXT("Batched removes and adds"), Check(*this, TEXT("Replaced"), Tracks, Replaced), 13);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyPlaylistDiffUnavailableTest, "Spotify.PlaylistDiff.Unavailable",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyPlaylistDiffUnavailableTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyPlaylistDiffTest;
+
+	// An unavailable track has no uri to remove it by, the playlist is rewritten instead.
+	const TArray<FString> Tracks = MakeTracks(10);
+	TArray<FString> Current = Tracks;
+	Current.Insert(FString(), 4);
+
+	const TArray<FSpotifyPlaylistMutation> Mutations = FSpotifyPlaylistDiff::Compute(Current, Tracks);
+	if(TestEqual(TEXT("Single request"), Mutations.Num(), 1))
+	{
+		TestTrue(TEXT("Is a replace"), Mutations[0].Op == ESpotifyPlaylistOp::Replace);
+	}
+	Check(*this, TEXT("Unavailable"), Current, Tracks);
+	return true;
+}
+
+#endif
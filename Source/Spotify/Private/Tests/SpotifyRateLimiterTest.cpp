@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyRateLimiter.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyRateLimiterBurstTest, "Spotify.RateLimiter.Burst",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyRateLimiterBurstTest::RunTest(const FString& Parameters)
+{
+	FSpotifyRateLimiter Limiter(2.f, 3.f);
+	const double Start = 100.0;
+
+	// Starts full: a burst, then nothing until a token refilled.
+	for(int32 Index = 0; Index < 3; Index++)
+	{
+		TestTrue(TEXT("Burst"), Limiter.TryAcquire(Start));
+	}
+	TestFalse(TEXT("Empty after the burst"), Limiter.TryAcquire(Start));
+	TestEqual(TEXT("Wait for one token"), Limiter.GetWaitSeconds(Start), 0.5);
+	TestFalse(TEXT("Not refilled yet"), Limiter.TryAcquire(Start + 0.4));
+	TestTrue(TEXT("Refilled"), Limiter.TryAcquire(Start + 0.5));
+
+	// A long pause refills no further than the burst.
+	const double Later = Start + 60.0;
+	TestEqual(TEXT("No wait when tokens are left"), Limiter.GetWaitSeconds(Later), 0.0);
+	int32 Acquired = 0;
+	while(Limiter.TryAcquire(Later))
+	{
+		Acquired++;
+	}
+	TestEqual(TEXT("Capped at the burst"), Acquired, 3);
+
+	// Steady state: Rate tokens per second.
+	Acquired = 0;
+	for(double Now = Later; Now < Later + 10.0; Now += 0.01)
+	{
+		Acquired += Limiter.TryAcquire(Now) ? 1 : 0;
+	}
+	TestTrue(TEXT("Rate held"), Acquired >= 19 && Acquired <= 20);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyRateLimiterBlockTest, "Spotify.RateLimiter.Block",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyRateLimiterBlockTest::RunTest(const FString& Parameters)
+{
+	FSpotifyRateLimiter Limiter(4.f, 4.f);
+	const double Start = 10.0;
+
+	// A 429 blocks even a full bucket, and it starts empty once the block is over.
+	Limiter.BlockFor(Start, 2.0);
+	TestFalse(TEXT("Blocked"), Limiter.TryAcquire(Start + 1.0));
+	TestEqual(TEXT("Wait for the block"), Limiter.GetWaitSeconds(Start + 1.0), 1.0);
+	TestFalse(TEXT("Empty at the end of the block"), Limiter.TryAcquire(Start + 2.0));
+	TestEqual(TEXT("Then waits for a token"), Limiter.GetWaitSeconds(Start + 2.0), 0.25);
+	TestTrue(TEXT("Token after the block"), Limiter.TryAcquire(Start + 2.25));
+
+	// A shorter block doesn't cut a longer one short.
+	Limiter.BlockFor(Start + 3.0, 5.0);
+	Limiter.BlockFor(Start + 3.0, 1.0);
+	TestFalse(TEXT("Longer block kept"), Limiter.TryAcquire(Start + 7.0));
+	TestTrue(TEXT("Released"), Limiter.TryAcquire(Start + 8.25));
+
+	// Configure starts over with a full bucket.
+	Limiter.Configure(1.f, 2.f);
+	TestTrue(TEXT("Full after configure"), Limiter.TryAcquire(Start + 8.25));
+	TestTrue(TEXT("Full after configure"), Limiter.TryAcquire(Start + 8.25));
+	TestFalse(TEXT("New burst"), Limiter.TryAcquire(Start + 8.25));
+	return true;
+}
+
+#endif
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyResponseDecoder.h"
+#include "SpotifyTestResponse.h"
+#include "Dom/JsonObject.h"
+#include "Misc/AutomationTest.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SpotifyResponseDecoderTest
+{
+	// WindowBits picks the framing like inflateInit2 does: 15 zlib, 31 gzip, -15 raw deflate.
+	TArray<uint8> Compress(const TArray<uint8>& Source, int WindowBits)
+	{
+		z_stream Stream;
+		FMemory::Memzero(Stream);
+		deflateInit2(&Stream, Z_BEST_COMPRESSION, Z_DEFLATED, WindowBits, 8, Z_DEFAULT_STRATEGY);
+		TArray<uint8> Result;
+		Result.SetNumUninitialized(deflateBound(&Stream, Source.Num()) + 32);
+		Stream.next_in = const_cast<Bytef*>(Source.GetData());
+		Stream.avail_in = Source.Num();
+		Stream.next_out = Result.GetData();
+		Stream.avail_out = Result.Num();
+		deflate(&Stream, Z_FINISH);
+		Result.SetNum(Result.Num() - Stream.avail_out);
+		deflateEnd(&Stream);
+		return Result;
+	}
+
+	FSpotifyDecodeResult Decode(const TArray<uint8>& Body, const TMap<FString, FString>& Headers)
+	{
+		return FSpotifyResponseDecoder::Decode(MakeShared<FSpotifyTestResponse, ESPMode::ThreadSafe>(200, Body, Headers));
+	}
+
+	// A playlist page well past the decoder's 16k chunks, with multi-byte characters and a surrogate pair
+	// (U+1F3B5) so sequences end up split across chunk boundaries.
+	TArray<uint8> MakeFixture(int32 Tracks)
+	{
+		FString Json = TEXT("{\"items\":[");
+		for(int32 Index = 0; Index < Tracks; Index++)
+		{
+			Json += FString::Printf(TEXT("%s{\"name\":\"Caf\u00E9 \u30C8\u30E9\u30C3\u30AF %d \U0001F3B5\",\"position\":%d}"), Index ? TEXT(",") : TEXT(""), Index, Index);
+		}
+		Json += TEXT("]}");
+		const FTCHARToUTF8 Utf8(*Json);
+		return TArray<uint8>(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+
+	bool CheckFixture(FAutomationTestBase& Test, const FString& What, const FSpotifyDecodeResult& Result, int32 Tracks)
+	{
+		if(!Test.TestTrue(What + TEXT(" parsed"), Result.Json.IsValid())) return false;
+		const TArray<TSharedPtr<FJsonValue>>* Items;
+		if(!Test.TestTrue(What + TEXT(" has items"), Result.Json->TryGetArrayField(TEXT("items"), Items))) return false;
+		Test.TestEqual(What + TEXT(" item count"), Items->Num(), Tracks);
+		for(int32 Index = 0; Index < Items->Num(); Index++)
+		{
+			const FString Expected = FString::Printf(TEXT("Caf\u00E9 \u30C8\u30E9\u30C3\u30AF %d \U0001F3B5"), Index);
+			if(!Test.TestEqual(What + TEXT(" name"), (*Items)[Index]->AsObject()->GetStringField(TEXT("name")), Expected)) return false;
+		}
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyResponseDecoderFramingTest, "Spotify.ResponseDecoder.Framing",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyResponseDecoderFramingTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyResponseDecoderTest;
+	const int32 Tracks = 600;
+	const TArray<uint8> Plain = MakeFixture(Tracks);
+
+	const FSpotifyDecodeResult Identity = Decode(Plain, {});
+	CheckFixture(*this, TEXT("Identity"), Identity, Tracks);
+	TestFalse(TEXT("Identity not compressed"), Identity.bCompressed);
+	TestEqual(TEXT("Identity wire bytes"), Identity.WireBytes, int64(Plain.Num()));
+	TestEqual(TEXT("Identity decoded bytes"), Identity.DecodedBytes, int64(Plain.Num()));
+
+	struct FFraming
+	{
+		const TCHAR* Name;
+		const TCHAR* ContentEncoding;
+		int WindowBits;
+	};
+	const FFraming Framings[] = {{TEXT("gzip"), TEXT("gzip"), MAX_WBITS + 16}, {TEXT("zlib"), TEXT("deflate"), MAX_WBITS}, {TEXT("raw deflate"), TEXT("deflate"), -MAX_WBITS}};
+	for(const FFraming& Framing : Framings)
+	{
+		const TArray<uint8> Encoded = Compress(Plain, Framing.WindowBits);
+		const FSpotifyDecodeResult Result = Decode(Encoded, {{TEXT("Content-Encoding"), Framing.ContentEncoding}});
+		CheckFixture(*this, Framing.Name, Result, Tracks);
+		TestTrue(FString(Framing.Name) + TEXT(" compressed"), Result.bCompressed);
+		TestEqual(FString(Framing.Name) + TEXT(" wire bytes"), Result.WireBytes, int64(Encoded.Num()));
+		TestEqual(FString(Framing.Name) + TEXT(" decoded bytes"), Result.DecodedBytes, int64(Plain.Num()));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyResponseDecoderWireBytesTest, "Spotify.ResponseDecoder.WireBytes",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyResponseDecoderWireBytesTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyResponseDecoderTest;
+	const TArray<uint8> Plain = MakeFixture(100);
+	const TArray<uint8> Gzip = Compress(Plain, MAX_WBITS + 16);
+	const FString GzipLength = FString::FromInt(Gzip.Num());
+
+	// The backend inflated the body but kept the headers: the wire size comes from Content-Length.
+	const FSpotifyDecodeResult Inflated = Decode(Plain, {{TEXT("Content-Encoding"), TEXT("gzip")}, {TEXT("Content-Length"), GzipLength}});
+	CheckFixture(*this, TEXT("Inflated"), Inflated, 100);
+	TestTrue(TEXT("Inflated counts as compressed"), Inflated.bCompressed);
+	TestEqual(TEXT("Inflated wire bytes"), Inflated.WireBytes, int64(Gzip.Num()));
+
+	// Same, but chunked: the wire size is unknown and stays out of the stats.
+	const FSpotifyDecodeResult Chunked = Decode(Plain, {{TEXT("Content-Encoding"), TEXT("gzip")}});
+	CheckFixture(*this, TEXT("Chunked"), Chunked, 100);
+	TestEqual(TEXT("Chunked wire bytes unknown"), Chunked.WireBytes, int64(-1));
+
+	FSpotifyTransferStats Stats;
+	Stats.Add(Inflated);
+	Stats.Add(Chunked);
+	TestEqual(TEXT("Responses"), Stats.Responses, 2);
+	TestEqual(TEXT("Compressed responses"), Stats.CompressedResponses, 2);
+	TestEqual(TEXT("Bytes on wire"), Stats.BytesOnWire, int64(Gzip.Num()));
+	TestEqual(TEXT("Bytes decoded"), Stats.BytesDecoded, int64(Plain.Num()));
+
+	// A corrupt stream fails instead of yielding a partial object.
+	TArray<uint8> Corrupt = Gzip;
+	Corrupt.SetNum(Corrupt.Num() / 2);
+	Corrupt.Append(Plain.GetData(), 64);
+	TestFalse(TEXT("Corrupt stream rejected"), Decode(Corrupt, {{TEXT("Content-Encoding"), TEXT("gzip")}}).Json.IsValid());
+	return true;
+}
+
+#endif
@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyResult.h"
+#include "SpotifyAsyncAction.h"
+#include "SpotifyService.h"
+#include "SpotifyTestListener.h"
+#include "SpotifyTestResponse.h"
+#include "Engine/GameInstance.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SpotifyResultTest
+{
+	FSpotifyError Classify(int32 ResponseCode, ESpotifyEndpoint Endpoint, const FString& Body = FString(), TMap<FString, FString> Headers = {})
+	{
+		const FHttpResponsePtr Response = MakeShared<FSpotifyTestResponse, ESPMode::ThreadSafe>(ResponseCode, Body, MoveTemp(Headers));
+		return FSpotifyError::FromResponse(Response, true, Endpoint);
+	}
+
+	FString Name(ESpotifyError Code)
+	{
+		return UEnum::GetValueAsString(Code);
+	}
+
+	TArray<FSpotifyDevice> MakeDevices()
+	{
+		FSpotifyDevice Device;
+		Device.Id = TEXT("device");
+		Device.Name = TEXT("Speaker");
+		Device.bActive = true;
+		return {Device};
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyErrorMappingTest, "Spotify.Result.ErrorMapping",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyErrorMappingTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyResultTest;
+
+	const FSpotifyError Ok = Classify(204, ESpotifyEndpoint::Play);
+	TestEqual(TEXT("2xx"), Name(Ok.Code), Name(ESpotifyError::None));
+	TestEqual(TEXT("2xx status"), Ok.StatusCode, 204);
+
+	TestEqual(TEXT("401"), Name(Classify(401, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::InvalidAccessKey));
+	TestEqual(TEXT("403"), Name(Classify(403, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::NonPremium));
+
+	// Only the player answers 404 when nothing is playing, anywhere else the resource doesn't exist.
+	TestEqual(TEXT("404 from the player"), Name(Classify(404, ESpotifyEndpoint::Pause).Code), Name(ESpotifyError::NoActiveDevice));
+	TestEqual(TEXT("404 from the queue"), Name(Classify(404, ESpotifyEndpoint::Queue).Code), Name(ESpotifyError::NoActiveDevice));
+	TestEqual(TEXT("404 from a playlist"), Name(Classify(404, ESpotifyEndpoint::Playlist).Code), Name(ESpotifyError::NotFound));
+	TestEqual(TEXT("404 from an analysis"), Name(Classify(404, ESpotifyEndpoint::AudioAnalysis).Code), Name(ESpotifyError::NotFound));
+
+	const FSpotifyError Limited = Classify(429, ESpotifyEndpoint::Queue, FString(), {{TEXT("Retry-After"), TEXT("7")}});
+	TestEqual(TEXT("429"), Name(Limited.Code), Name(ESpotifyError::RateLimited));
+	TestEqual(TEXT("429 Retry-After"), Limited.RetryAfterSeconds, 7);
+	TestEqual(TEXT("429 without Retry-After still backs off"), Classify(429, ESpotifyEndpoint::Queue).RetryAfterSeconds, 1);
+	TestEqual(TEXT("Retry-After only with 429"), Classify(503, ESpotifyEndpoint::Queue, FString(), {{TEXT("Retry-After"), TEXT("7")}}).RetryAfterSeconds, 0);
+
+	TestEqual(TEXT("500"), Name(Classify(500, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::ServerError));
+	TestEqual(TEXT("503"), Name(Classify(503, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::ServerError));
+	TestEqual(TEXT("Other 4xx"), Name(Classify(400, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::Unknown));
+
+	const FSpotifyError WithMessage = Classify(404, ESpotifyEndpoint::Playlist, TEXT("{\"error\":{\"status\":404,\"message\":\"Invalid playlist Id\"}}"));
+	TestEqual(TEXT("Message"), WithMessage.Message, FString(TEXT("Invalid playlist Id")));
+	TestEqual(TEXT("Status"), WithMessage.StatusCode, 404);
+	TestEqual(TEXT("Garbage body, no message"), Classify(500, ESpotifyEndpoint::Play, TEXT("<html>")).Message, FString());
+
+	// No answer at all.
+	const FHttpResponsePtr Answered = MakeShared<FSpotifyTestResponse, ESPMode::ThreadSafe>(200, FString());
+	const FSpotifyError Failed = FSpotifyError::FromResponse(Answered, false, ESpotifyEndpoint::Play);
+	TestEqual(TEXT("Transport failure"), Name(Failed.Code), Name(ESpotifyError::ConnectionFailed));
+	TestEqual(TEXT("Transport failure status"), Failed.StatusCode, 0);
+	TestEqual(TEXT("No response"), Name(FSpotifyError::FromResponse(nullptr, true, ESpotifyEndpoint::Play).Code), Name(ESpotifyError::ConnectionFailed));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyPromiseTest, "Spotify.Result.Promise",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyPromiseTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyResultTest;
+
+	TFuture<TSpotifyResult<void>> Fulfilled;
+	{
+		TSpotifyPromise<TSpotifyResult<void>> Promise;
+		Fulfilled = Promise.GetFuture();
+		Promise.SetValue(TSpotifyResult<void>{FSpotifyError::Make(ESpotifyError::NonPremium)});
+	}
+	TestEqual(TEXT("Set value kept"), Name(Fulfilled.Get().Error.Code), Name(ESpotifyError::NonPremium));
+
+	// E.g. the service was torn down while the response was decoding.
+	TFuture<TSpotifyResult<TArray<FSpotifyDevice>>> Dropped;
+	{
+		TSpotifyPromise<TSpotifyResult<TArray<FSpotifyDevice>>> Promise;
+		Dropped = Promise.GetFuture();
+	}
+	TestTrue(TEXT("Dropped promise answers"), Dropped.IsReady());
+	TestEqual(TEXT("Dropped promise fails"), Name(Dropped.Get().Error.Code), Name(ESpotifyError::ConnectionFailed));
+	TestEqual(TEXT("Dropped promise has no devices"), Dropped.Get().Value.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyLatentNodeTest, "Spotify.Result.LatentNodes",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyLatentNodeTest::RunTest(const FString& Parameters)
+{
+	using namespace SpotifyResultTest;
+	using FDevicesResult = TSpotifyResult<TArray<FSpotifyDevice>>;
+
+	UGameInstance* GameInstance = NewObject<UGameInstance>(GetTransientPackage());
+	USpotifyService* Service = NewObject<USpotifyService>(GameInstance);
+
+	// Accepted command.
+	{
+		USpotifyTestListener* Listener = NewObject<USpotifyTestListener>();
+		USpotifyCommandAction* Action = USpotifyCommandAction::CreateForTest(Service, [](USpotifyService&)
+		{
+			return MakeFulfilledPromise<TSpotifyResult<void>>().GetFuture();
+		});
+		Action->OnSuccess.AddDynamic(Listener, &USpotifyTestListener::OnCommandSuccess);
+		Action->OnFailure.AddDynamic(Listener, &USpotifyTestListener::OnCommandFailure);
+		Action->Activate();
+		TestEqual(TEXT("Command OnSuccess"), Listener->Successes, 1);
+		TestEqual(TEXT("Command no OnFailure"), Listener->Failures, 0);
+		TestEqual(TEXT("Command OnSuccess error"), Name(Listener->LastError.Code), Name(ESpotifyError::None));
+	}
+
+	// Refused command, answered later: nothing fires until it is.
+	{
+		USpotifyTestListener* Listener = NewObject<USpotifyTestListener>();
+		TPromise<TSpotifyResult<void>> Pending;
+		USpotifyCommandAction* Action = USpotifyCommandAction::CreateForTest(Service, [&Pending](USpotifyService&)
+		{
+			return Pending.GetFuture();
+		});
+		Action->OnSuccess.AddDynamic(Listener, &USpotifyTestListener::OnCommandSuccess);
+		Action->OnFailure.AddDynamic(Listener, &USpotifyTestListener::OnCommandFailure);
+		Action->Activate();
+		TestEqual(TEXT("Pending command fires nothing"), Listener->Successes + Listener->Failures, 0);
+		Pending.SetValue(TSpotifyResult<void>{FSpotifyError::Make(ESpotifyError::NoActiveDevice)});
+		TestEqual(TEXT("Command no OnSuccess"), Listener->Successes, 0);
+		TestEqual(TEXT("Command OnFailure"), Listener->Failures, 1);
+		TestEqual(TEXT("Command OnFailure error"), Name(Listener->LastError.Code), Name(ESpotifyError::NoActiveDevice));
+	}
+
+	// No service to send the command with.
+	{
+		USpotifyTestListener* Listener = NewObject<USpotifyTestListener>();
+		bool bSent = false;
+		USpotifyCommandAction* Action = USpotifyCommandAction::CreateForTest(nullptr, [&bSent](USpotifyService&)
+		{
+			bSent = true;
+			return MakeFulfilledPromise<TSpotifyResult<void>>().GetFuture();
+		});
+		Action->OnSuccess.AddDynamic(Listener, &USpotifyTestListener::OnCommandSuccess);
+		Action->OnFailure.AddDynamic(Listener, &USpotifyTestListener::OnCommandFailure);
+		Action->Activate();
+		TestFalse(TEXT("Nothing sent without a service"), bSent);
+		TestEqual(TEXT("No service OnFailure"), Listener->Failures, 1);
+		TestEqual(TEXT("No service error"), Name(Listener->LastError.Code), Name(ESpotifyError::NotAuthorized));
+	}
+
+	// Devices listed.
+	{
+		USpotifyTestListener* Listener = NewObject<USpotifyTestListener>();
+		USpotifyGetDevicesAction* Action = USpotifyGetDevicesAction::CreateForTest(Service, [](USpotifyService&)
+		{
+			return MakeFulfilledPromise<FDevicesResult>(FDevicesResult{MakeDevices(), FSpotifyError()}).GetFuture();
+		});
+		Action->OnSuccess.AddDynamic(Listener, &USpotifyTestListener::OnDevicesSuccess);
+		Action->OnFailure.AddDynamic(Listener, &USpotifyTestListener::OnDevicesFailure);
+		Action->Activate();
+		TestEqual(TEXT("Devices OnSuccess"), Listener->Successes, 1);
+		TestEqual(TEXT("Devices no OnFailure"), Listener->Failures, 0);
+		if(TestEqual(TEXT("Devices"), Listener->LastDevices.Num(), 1))
+		{
+			TestEqual(TEXT("Device id"), Listener->LastDevices[0].Id, FString(TEXT("device")));
+		}
+	}
+
+	// Devices request dropped unanswered.
+	{
+		USpotifyTestListener* Listener = NewObject<USpotifyTestListener>();
+		USpotifyGetDevicesAction* Action = USpotifyGetDevicesAction::CreateForTest(Service, [](USpotifyService&)
+		{
+			const TSharedRef<TSpotifyPromise<FDevicesResult>> Promise = MakeShared<TSpotifyPromise<FDevicesResult>>();
+			return Promise->GetFuture();
+		});
+		Action->OnSuccess.AddDynamic(Listener, &USpotifyTestListener::OnDevicesSuccess);
+		Action->OnFailure.AddDynamic(Listener, &USpotifyTestListener::OnDevicesFailure);
+		Action->Activate();
+		TestEqual(TEXT("Dropped devices no OnSuccess"), Listener->Successes, 0);
+		TestEqual(TEXT("Dropped devices OnFailure"), Listener->Failures, 1);
+		TestEqual(TEXT("Dropped devices error"), Name(Listener->LastError.Code), Name(ESpotifyError::ConnectionFailed));
+	}
+
+	Service->MarkAsGarbage();
+	GameInstance->MarkAsGarbage();
+	return true;
+}
+
+#endif
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "SpotifyResult.h"
+#include "SpotifyTestListener.generated.h"
+
+// Records what the latent nodes broadcast, their delegates only bind to UFUNCTIONs.
+UCLASS(Transient)
+class USpotifyTestListener : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UFUNCTION()
+	void OnCommandSuccess(const FSpotifyError& Error) { Successes++; LastError = Error; }
+
+	UFUNCTION()
+	void OnCommandFailure(const FSpotifyError& Error) { Failures++; LastError = Error; }
+
+	UFUNCTION()
+	void OnDevicesSuccess(const TArray<FSpotifyDevice>& Devices, const FSpotifyError& Error) { Successes++; LastDevices = Devices; LastError = Error; }
+
+	UFUNCTION()
+	void OnDevicesFailure(const TArray<FSpotifyDevice>& Devices, const FSpotifyError& Error) { Failures++; LastDevices = Devices; LastError = Error; }
+
+	int32 Successes = 0;
+
+	int32 Failures = 0;
+
+	FSpotifyError LastError;
+
+	TArray<FSpotifyDevice> LastDevices;
+};
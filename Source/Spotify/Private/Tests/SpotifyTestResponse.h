@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// A finished response with a fixed status, body and headers, for tests that never go on the wire.
+class FSpotifyTestResponse final : public IHttpResponse
+{
+public:
+
+	FSpotifyTestResponse(int32 InResponseCode, TArray<uint8> InBody, TMap<FString, FString> InHeaders)
+		: ResponseCode(InResponseCode)
+		, Body(MoveTemp(InBody))
+		, Headers(MoveTemp(InHeaders))
+	{
+	}
+
+	FSpotifyTestResponse(int32 InResponseCode, const FString& InBody, TMap<FString, FString> InHeaders = {})
+		: ResponseCode(InResponseCode)
+		, Headers(MoveTemp(InHeaders))
+	{
+		const FTCHARToUTF8 Utf8(*InBody);
+		Body.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+
+	virtual FString GetURL() const override { return TEXT("https://api.spotify.com/v1/fixture"); }
+	virtual FString GetURLParameter(const FString& ParameterName) const override { return FString(); }
+	virtual FString GetHeader(const FString& HeaderName) const override
+	{
+		const FString* Value = Headers.Find(HeaderName);
+		return Value ? *Value : FString();
+	}
+	virtual TArray<FString> GetAllHeaders() const override
+	{
+		TArray<FString> Result;
+		for(const TPair<FString, FString>& Header : Headers)
+		{
+			Result.Add(Header.Key + TEXT(": ") + Header.Value);
+		}
+		return Result;
+	}
+	virtual FString GetContentType() const override { return TEXT("application/json"); }
+	virtual int32 GetContentLength() const override { return Body.Num(); }
+	virtual const TArray<uint8>& GetContent() const override { return Body; }
+	virtual int32 GetResponseCode() const override { return ResponseCode; }
+	virtual FString GetContentAsString() const override
+	{
+		const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Body.GetData()), Body.Num());
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+private:
+
+	int32 ResponseCode;
+
+	TArray<uint8> Body;
+
+	TMap<FString, FString> Headers;
+};
+
+#endif
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyAccount.h"
+#include "SpotifyTimerWheel.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Ticks of one second keep the deadlines exact, the wheel itself only counts ticks.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyTimerWheelDeadlineTest, "Spotify.TimerWheel.Deadlines",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyTimerWheelDeadlineTest::RunTest(const FString& Parameters)
+{
+	FSpotifyTimerWheel Wheel(1.0);
+	FRandomStream Random(1234);
+
+	// Deadlines on every level of the wheel, on level boundaries and past its range.
+	TArray<int64> Deadlines = {1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145, 16777215, 16777216, 16777300};
+	for(int32 i = 0; i < 500; i++)
+	{
+		const int32 Level = Random.RandRange(0, 3);
+		Deadlines.Add(Random.RandRange(1, Level == 0 ? 64 : Level == 1 ? 5000 : Level == 2 ? 300000 : 17000000));
+	}
+	for(int32 Payload = 0; Payload < Deadlines.Num(); Payload++)
+	{
+		Wheel.Schedule(static_cast<double>(Deadlines[Payload]), Payload);
+	}
+	TestEqual(TEXT("Scheduled"), Wheel.Num(), Deadlines.Num());
+
+	TArray<int64> Fired;
+	Fired.Init(INDEX_NONE, Deadlines.Num());
+	int64 Tick = 0;
+	const auto OnExpired = [&Fired, &Tick](uint64 Payload)
+	{
+		int64& FiredAt = Fired[static_cast<int32>(Payload)];
+		FiredAt = FiredAt == INDEX_NONE ? Tick : -2;
+	};
+
+	// One tick at a time, so every timer is seen firing in exactly the tick it is due.
+	while(Wheel.Num() > 0 && Tick < 17000001)
+	{
+		Tick++;
+		Wheel.Advance(Tick + 0.5, OnExpired);
+	}
+
+	int32 Wrong = 0;
+	for(int32 Payload = 0; Payload < Deadlines.Num(); Payload++)
+	{
+		if(Fired[Payload] != Deadlines[Payload])
+		{
+			Wrong++;
+			AddError(FString::Printf(TEXT("Timer due at %lld fired at %lld"), Deadlines[Payload], Fired[Payload]));
+		}
+	}
+	TestEqual(TEXT("Every timer fired once, on time"), Wrong, 0);
+	TestEqual(TEXT("Nothing left"), Wheel.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyTimerWheelCancelTest, "Spotify.TimerWheel.Cancel",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyTimerWheelCancelTest::RunTest(const FString& Parameters)
+{
+	FSpotifyTimerWheel Wheel(1.0);
+	TArray<uint64> Fired;
+	const auto OnExpired = [&Fired](uint64 Payload) { Fired.Add(Payload); };
+
+	FSpotifyTimerHandle First = Wheel.Schedule(10.0, 1);
+	FSpotifyTimerHandle Second = Wheel.Schedule(10.0, 2);
+	TestTrue(TEXT("Scheduled"), Wheel.IsScheduled(First));
+
+	Wheel.Cancel(First);
+	TestFalse(TEXT("Cancelled handle is invalid"), First.IsValid());
+	TestEqual(TEXT("One left"), Wheel.Num(), 1);
+
+	// The freed entry is reused, a stale copy of the old handle must not touch the new timer.
+	FSpotifyTimerHandle Stale;
+	Stale.Index = Second.Index == 0 ? 1 : 0;
+	Stale.Serial = 0;
+	const FSpotifyTimerHandle Reused = Wheel.Schedule(5.0, 3);
+	TestEqual(TEXT("Entry reused"), Reused.Index, Stale.Index);
+	Wheel.Cancel(Stale);
+	TestTrue(TEXT("Stale handle didn't cancel the new timer"), Wheel.IsScheduled(Reused));
+
+	Wheel.Advance(20.5, OnExpired);
+	TestEqual(TEXT("Fired"), Fired, TArray<uint64>({3, 2}));
+	TestFalse(TEXT("Expired timers aren't scheduled"), Wheel.IsScheduled(Second));
+
+	// Cancelling an expired timer is a no-op.
+	Wheel.Cancel(Second);
+	TestEqual(TEXT("Empty"), Wheel.Num(), 0);
+
+	Wheel.Schedule(1.0, 4);
+	Wheel.Reset(100.0);
+	Fired.Reset();
+	Wheel.Advance(200.5, OnExpired);
+	TestEqual(TEXT("Reset drops every timer"), Fired.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyTimerWheelRescheduleTest, "Spotify.TimerWheel.Reschedule",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyTimerWheelRescheduleTest::RunTest(const FString& Parameters)
+{
+	FSpotifyTimerWheel Wheel(1.0);
+
+	// Like the playback polls: every expiry schedules the next one, the wheel may be advanced in big steps.
+	int32 Polls = 0;
+	FSpotifyTimerHandle Cancelled = Wheel.Schedule(50.0, 2);
+	Wheel.Schedule(10.0, 1);
+	Wheel.Advance(1000.5, [&Wheel, &Polls, &Cancelled](uint64 Payload)
+	{
+		if(Payload == 1)
+		{
+			Polls++;
+			Wheel.Cancel(Cancelled);
+			Wheel.Schedule(10.0, 1);
+		}
+	});
+	TestEqual(TEXT("Rescheduled polls"), Polls, 100);
+	TestEqual(TEXT("Only the next poll is left"), Wheel.Num(), 1);
+
+	// A timer scheduled with no delay still waits for the next tick.
+	bool bFired = false;
+	Wheel.Reset(0.0);
+	Wheel.Schedule(0.0, 3);
+	Wheel.Advance(0.5, [&bFired](uint64) { bFired = true; });
+	TestFalse(TEXT("Not in the current tick"), bFired);
+	Wheel.Advance(1.5, [&bFired](uint64) { bFired = true; });
+	TestTrue(TEXT("Next tick"), bFired);
+	return true;
+}
+
+// What every further account costs the game thread: its refresh and poll deadlines on the wheel, polled once a
+// second over a minute at 60 frames per second. The HTTP requests share the module's connection pool and happen
+// off the game thread either way.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyAccountScalingBenchmark, "Spotify.Benchmark.AccountScaling",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FSpotifyAccountScalingBenchmark::RunTest(const FString& Parameters)
+{
+	static constexpr double PollInterval = 1.0;
+	static constexpr int32 Frames = 60 * 60;
+
+	AddInfo(FString::Printf(TEXT("Account state: %d bytes per account"), static_cast<int32>(sizeof(FSpotifyAccount))));
+	for(const int32 NumAccounts : {1, 4, 16, 64, 256})
+	{
+		FSpotifyTimerWheel Wheel;
+		for(int32 AccountIndex = 0; AccountIndex < NumAccounts; AccountIndex++)
+		{
+			Wheel.Schedule(3550.0, FSpotifyAccount::MakeTimerPayload(AccountIndex, ESpotifyTimer::RefreshAccessKey));
+			Wheel.Schedule(PollInterval * (1.0 + double(AccountIndex) / NumAccounts),
+				FSpotifyAccount::MakeTimerPayload(AccountIndex, ESpotifyTimer::RequestPlaybackInformation));
+		}
+
+		int32 Polls = 0;
+		const auto OnExpired = [&Wheel, &Polls](uint64 Payload)
+		{
+			Polls++;
+			Wheel.Schedule(PollInterval, Payload);
+		};
+
+		const double Start = FPlatformTime::Seconds();
+		for(int32 Frame = 1; Frame <= Frames; Frame++)
+		{
+			Wheel.Advance(Frame / 60.0, OnExpired);
+		}
+		const double Elapsed = FPlatformTime::Seconds() - Start;
+
+		AddInfo(FString::Printf(TEXT("%3d accounts: %d polls, %.3f us per frame, %.3f us per account and frame"),
+			NumAccounts, Polls, Elapsed * 1e6 / Frames, Elapsed * 1e6 / Frames / NumAccounts));
+		TestTrue(TEXT("Every account polled about once a second"), Polls >= NumAccounts * 58);
+	}
+	return true;
+}
+
+#endif
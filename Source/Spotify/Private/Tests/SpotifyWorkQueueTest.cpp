@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyWorkQueue.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyWorkQueueOrderTest, "Spotify.WorkQueue.Order",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyWorkQueueOrderTest::RunTest(const FString& Parameters)
+{
+	FSpotifyWorkQueue Queue;
+	TArray<int32> Ran;
+
+	// Priority first, first in first out within a priority.
+	Queue.Enqueue(ESpotifyWorkPriority::Background, [&Ran]() { Ran.Add(30); });
+	Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Ran]() { Ran.Add(20); });
+	Queue.Enqueue(ESpotifyWorkPriority::UserVisible, [&Ran]() { Ran.Add(10); });
+	Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Ran]() { Ran.Add(21); });
+	Queue.Enqueue(ESpotifyWorkPriority::UserVisible, [&Ran]() { Ran.Add(11); });
+	TestEqual(TEXT("Pending"), Queue.Num(), 5);
+	Queue.Flush();
+	TestEqual(TEXT("Order"), Ran, TArray<int32>({10, 11, 20, 21, 30}));
+	TestEqual(TEXT("Empty"), Queue.Num(), 0);
+
+	// Work queued by work runs in the same flush, more important work jumps ahead of what is left.
+	Ran.Reset();
+	Queue.Enqueue(ESpotifyWorkPriority::Background, [&Ran, &Queue]()
+	{
+		Ran.Add(1);
+		Queue.Enqueue(ESpotifyWorkPriority::Background, [&Ran]() { Ran.Add(3); });
+		Queue.Enqueue(ESpotifyWorkPriority::UserVisible, [&Ran]() { Ran.Add(2); });
+	});
+	Queue.Flush();
+	TestEqual(TEXT("Nested"), Ran, TArray<int32>({1, 2, 3}));
+
+	// A long list is consumed (and compacted) without losing its order.
+	Ran.Reset();
+	for(int32 Index = 0; Index < 300; Index++)
+	{
+		Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Ran, Index]() { Ran.Add(Index); });
+	}
+	for(int32 Index = 0; Index < 150; Index++)
+	{
+		Queue.Drain(0.0);
+	}
+	for(int32 Index = 300; Index < 400; Index++)
+	{
+		Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Ran, Index]() { Ran.Add(Index); });
+	}
+	Queue.Flush();
+	bool bInOrder = Ran.Num() == 400;
+	for(int32 Index = 0; bInOrder && Index < Ran.Num(); Index++)
+	{
+		bInOrder = Ran[Index] == Index;
+	}
+	TestTrue(TEXT("Long list in order"), bInOrder);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyWorkQueueBudgetTest, "Spotify.WorkQueue.Budget",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyWorkQueueBudgetTest::RunTest(const FString& Parameters)
+{
+	FSpotifyWorkQueue Queue;
+	int32 Runs = 0;
+	for(int32 Index = 0; Index < 3; Index++)
+	{
+		Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Runs]()
+		{
+			Runs++;
+			FPlatformProcess::Sleep(0.002f);
+		});
+	}
+
+	// Every item is larger than the budget: one per drain, never none.
+	Queue.Drain(0.001);
+	TestEqual(TEXT("One item per drain"), Runs, 1);
+	TestEqual(TEXT("Rest deferred"), Queue.Num(), 2);
+	Queue.Drain(0.001);
+	TestEqual(TEXT("Next frame"), Runs, 2);
+
+	const FSpotifyWorkQueueStats& Stats = Queue.GetStats();
+	TestEqual(TEXT("Items run"), Stats.ItemsRun, 2);
+	TestEqual(TEXT("Pending"), Stats.Pending, 1);
+	TestEqual(TEXT("Max pending"), Stats.MaxPending, 3);
+	TestEqual(TEXT("Deferred frames"), Stats.DeferredFrames, 2);
+	TestEqual(TEXT("Overruns"), Stats.Overruns, 2);
+	TestTrue(TEXT("Drain time"), Stats.LastDrainMs >= 2.f && Stats.MaxDrainMs >= Stats.LastDrainMs);
+
+	// A budget large enough runs everything.
+	Queue.Drain(10.0);
+	TestEqual(TEXT("Drained"), Runs, 3);
+	TestEqual(TEXT("Nothing pending"), Stats.Pending, 0);
+	TestEqual(TEXT("Not deferred"), Stats.DeferredFrames, 2);
+
+	Queue.Drain(0.001);
+	TestEqual(TEXT("Empty drain"), Stats.LastDrainMs, 0.f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSpotifyWorkQueueRegisteredTest, "Spotify.WorkQueue.Registered",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSpotifyWorkQueueRegisteredTest::RunTest(const FString& Parameters)
+{
+	FSpotifyWorkQueue Queue;
+	TArray<int32> Ran;
+	const int32 Notification = Queue.Register(ESpotifyWorkPriority::UserVisible, [&Ran]() { Ran.Add(1); });
+
+	// Posting again before it ran is a no-op.
+	Queue.Enqueue(ESpotifyWorkPriority::UserVisible, [&Ran]() { Ran.Add(0); });
+	Queue.Post(Notification);
+	Queue.Post(Notification);
+	Queue.Enqueue(ESpotifyWorkPriority::Normal, [&Ran]() { Ran.Add(2); });
+	Queue.Post(Notification);
+	TestEqual(TEXT("Coalesced"), Queue.Num(), 3);
+	Queue.Flush();
+	TestEqual(TEXT("Once, in its priority"), Ran, TArray<int32>({0, 1, 2}));
+
+	// Once it ran it can be posted again, also from its own work.
+	Ran.Reset();
+	int32 Reposts = 2;
+	const int32 Repeating = Queue.Register(ESpotifyWorkPriority::Background, [&Ran, &Queue, &Reposts, &Repeating]()
+	{
+		Ran.Add(3);
+		if(Reposts-- > 0)
+		{
+			Queue.Post(Repeating);
+		}
+	});
+	Queue.Post(Notification);
+	Queue.Post(Repeating);
+	Queue.Flush();
+	TestEqual(TEXT("Posted again"), Ran, TArray<int32>({1, 3, 3, 3}));
+	TestEqual(TEXT("Items run"), Queue.GetStats().ItemsRun, 7);
+	return true;
+}
+
+#endif
@@ -18,11 +18,18 @@ public class Spotify : ModuleRules
 			"Networking",
 			"Sockets",
 			"Json",
-			"DeveloperSettings"
+			"DeveloperSettings",
+			"UMG"
 		});
 
 		PrivateDependencyModuleNames.AddRange(new string[]
 		{
+			"Slate",
+			"SlateCore",
+			"ImageWrapper"
 		});
+
+		// Inflating compressed API responses.
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
 	}
 }
@@ -2,7 +2,27 @@
 
 #include "Spotify.h"
 #include "Modules/ModuleManager.h"
+#include "Private/Tests/SpotifyAllocationCounter.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Spotify, "Spotify" );
+class FSpotifyModule : public FDefaultGameModuleImpl
+{
+public:
 
-DEFINE_LOG_CATEGORY(LogSpotify);
\ No newline at end of file
+	virtual void StartupModule() override
+	{
+#if WITH_DEV_AUTOMATION_TESTS
+		FSpotifyAllocationCounter::InstallIfRequested();
+#endif
+	}
+
+	virtual void ShutdownModule() override
+	{
+#if WITH_DEV_AUTOMATION_TESTS
+		FSpotifyAllocationCounter::Uninstall();
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FSpotifyModule, Spotify, "Spotify" );
+
+DEFINE_LOG_CATEGORY(LogSpotify);
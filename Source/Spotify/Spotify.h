@@ -3,5 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSpotify, Log, Log);
+
+DECLARE_STATS_GROUP(TEXT("Spotify"), STATGROUP_Spotify, STATCAT_Advanced);
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+#include "SpotifyListeningHistory.h"
+#include "SpotifyNamePool.h"
+#include "SpotifyTimerWheel.h"
+
+// What a timer on the service's timer wheel is for, packed into the payload next to the account index.
+enum class ESpotifyTimer : uint8
+{
+	RefreshAccessKey,
+	RequestPlaybackInformation,
+	HedgePlaybackInformation,
+	PumpQueue,
+	// Not tied to an account, always scheduled for the default one.
+	KeepAlive
+};
+
+/**
+ * Everything the Spotify Service keeps per connected account.
+ * Accounts live in the services Accounts array and are addressed by their index.
+ */
+struct FSpotifyAccount
+{
+	// The name this account was configured with.
+	FName Name;
+
+	// Where the accounts credentials are saved.
+	FString SaveSlotName;
+
+	// Access Key (the Key used for executing API calls).
+	FString AccessKey;
+
+	// "Bearer <AccessKey>", built once per access key instead of for every request.
+	FString AuthorizationHeader;
+
+	// This key wont run out, it is used to refresh the Access key once it runs out.
+	FString RefreshKey;
+
+	// For the Proof-Key-Challenge-Exchange (PKCE).
+	FString Verify;
+
+	// The Auto-Generated Challenge for PKCE.
+	FString Challenge;
+
+	FDateTime AccessKeyExpiration;
+
+	FSpotifyTimerHandle RefreshTimer;
+
+	FSpotifyTimerHandle PlaybackInfoTimer;
+
+	// The playback info request in flight, its hedge, and when the request was sent.
+	FHttpRequestPtr PlaybackRequest;
+
+	FHttpRequestPtr PlaybackHedge;
+
+	double PlaybackRequestTime = 0.0;
+
+	FSpotifyTimerHandle HedgeTimer;
+
+	// Only call big update whenever song ID changes.
+	FSpotifyNameHandle SongId;
+
+	FSpotifyNameHandle SongName;
+
+	FSpotifyNameHandle AlbumName;
+
+	// Url of the album cover picked for display.
+	FSpotifyNameHandle AlbumImageUrl;
+
+	TArray<FSpotifyNameHandle, TInlineAllocator<4>> Artists;
+
+	// Progress and time (FPlatformTime::Seconds) of the last playback info, used to interpolate between polls.
+	int PlaybackProgress = 0;
+
+	int PlaybackDuration = 0;
+
+	double PlaybackSyncTime = 0.0;
+
+	bool bPlaying = false;
+
+	// The next poll builds the full update even if the song didn't change, set when the account becomes the active one.
+	bool bNeedsFullUpdate = false;
+
+	FSpotifyListeningHistory History;
+
+	// Start of the running play span and when the account was last seen playing in it (unix ms, 0 if no span runs).
+	int64 ListeningSpanStart = 0;
+
+	int64 ListeningSeenAt = 0;
+
+	void SetAccessKey(const FString& InAccessKey)
+	{
+		AccessKey = InAccessKey;
+		AuthorizationHeader = TEXT("Bearer ") + AccessKey;
+	}
+
+	static uint64 MakeTimerPayload(int32 AccountIndex, ESpotifyTimer Timer)
+	{
+		return (static_cast<uint64>(AccountIndex) << 8) | static_cast<uint64>(Timer);
+	}
+
+	static void BreakTimerPayload(uint64 Payload, int32& OutAccountIndex, ESpotifyTimer& OutTimer)
+	{
+		OutAccountIndex = static_cast<int32>(Payload >> 8);
+		OutTimer = static_cast<ESpotifyTimer>(Payload & 0xFF);
+	}
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyAsyncAction.h"
+#include "SpotifyService.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+namespace
+{
+	USpotifyService* FindService(UObject* WorldContextObject)
+	{
+		const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull) : nullptr;
+		const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		return GameInstance ? GameInstance->GetSubsystem<USpotifyService>() : nullptr;
+	}
+}
+
+USpotifyCommandAction* USpotifyCommandAction::Create(UObject* WorldContextObject, TFunction<TFuture<TSpotifyResult<void>>(USpotifyService&)> InCommand)
+{
+	USpotifyCommandAction* Action = NewObject<USpotifyCommandAction>();
+	Action->Service = FindService(WorldContextObject);
+	Action->Command = MoveTemp(InCommand);
+	Action->RegisterWithGameInstance(WorldContextObject);
+	return Action;
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyPlay(UObject* WorldContextObject)
+{
+	return Create(WorldContextObject, [](USpotifyService& Service) { return Service.Play(); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyPause(UObject* WorldContextObject)
+{
+	return Create(WorldContextObject, [](USpotifyService& Service) { return Service.Pause(); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyNext(UObject* WorldContextObject)
+{
+	return Create(WorldContextObject, [](USpotifyService& Service) { return Service.SkipToNext(); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyPrevious(UObject* WorldContextObject)
+{
+	return Create(WorldContextObject, [](USpotifyService& Service) { return Service.SkipToPrevious(); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifySeek(UObject* WorldContextObject, float PositionSeconds)
+{
+	const int32 PositionMs = FMath::RoundToInt(PositionSeconds * 1000.f);
+	return Create(WorldContextObject, [PositionMs](USpotifyService& Service) { return Service.SeekTo(PositionMs); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifySetVolume(UObject* WorldContextObject, float Volume)
+{
+	const int32 VolumePercent = FMath::RoundToInt(FMath::Clamp(Volume, 0.f, 1.f) * 100.f);
+	return Create(WorldContextObject, [VolumePercent](USpotifyService& Service) { return Service.SetVolumePercent(VolumePercent); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyTransferPlayback(UObject* WorldContextObject, const FString& DeviceId, bool bPlay)
+{
+	return Create(WorldContextObject, [DeviceId, bPlay](USpotifyService& Service) { return Service.TransferPlayback(DeviceId, bPlay); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyStartPlayback(UObject* WorldContextObject, const FSpotifyPlayRequest& PlayRequest)
+{
+	return Create(WorldContextObject, [PlayRequest](USpotifyService& Service) { return Service.StartPlayback(PlayRequest); });
+}
+
+USpotifyCommandAction* USpotifyCommandAction::SpotifyEnqueue(UObject* WorldContextObject, const TArray<FString>& Uris)
+{
+	return Create(WorldContextObject, [Uris](USpotifyService& Service) { return Service.Enqueue(Uris); });
+}
+
+void USpotifyCommandAction::Activate()
+{
+	USpotifyService* SpotifyService = Service.Get();
+	if(!SpotifyService)
+	{
+		Finish(FSpotifyError::Make(ESpotifyError::NotAuthorized, TEXT("No Spotify Service")));
+		return;
+	}
+
+	// Fulfilled on the game thread, the node is kept alive by the game instance until Finish.
+	Command(*SpotifyService).Next([WeakThis = TWeakObjectPtr<USpotifyCommandAction>(this)](const TSpotifyResult<void>& Result)
+	{
+		if(USpotifyCommandAction* This = WeakThis.Get())
+		{
+			This->Finish(Result.Error);
+		}
+	});
+}
+
+void USpotifyCommandAction::Finish(const FSpotifyError& Error)
+{
+	(Error.IsOk() ? OnSuccess : OnFailure).Broadcast(Error);
+	SetReadyToDestroy();
+}
+
+USpotifyGetDevicesAction* USpotifyGetDevicesAction::SpotifyGetDevices(UObject* WorldContextObject)
+{
+	USpotifyGetDevicesAction* Action = NewObject<USpotifyGetDevicesAction>();
+	Action->Service = FindService(WorldContextObject);
+	Action->Query = [](USpotifyService& Service) { return Service.GetDevices(); };
+	Action->RegisterWithGameInstance(WorldContextObject);
+	return Action;
+}
+
+void USpotifyGetDevicesAction::Activate()
+{
+	USpotifyService* SpotifyService = Service.Get();
+	if(!SpotifyService)
+	{
+		OnFailure.Broadcast(TArray<FSpotifyDevice>(), FSpotifyError::Make(ESpotifyError::NotAuthorized, TEXT("No Spotify Service")));
+		SetReadyToDestroy();
+		return;
+	}
+
+	Query(*SpotifyService).Next([WeakThis = TWeakObjectPtr<USpotifyGetDevicesAction>(this)](const TSpotifyResult<TArray<FSpotifyDevice>>& Result)
+	{
+		if(USpotifyGetDevicesAction* This = WeakThis.Get())
+		{
+			(Result.IsOk() ? This->OnSuccess : This->OnFailure).Broadcast(Result.Value, Result.Error);
+			This->SetReadyToDestroy();
+		}
+	});
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+USpotifyCommandAction* USpotifyCommandAction::CreateForTest(USpotifyService* InService, TFunction<TFuture<TSpotifyResult<void>>(USpotifyService&)> InCommand)
+{
+	USpotifyCommandAction* Action = NewObject<USpotifyCommandAction>();
+	Action->Service = InService;
+	Action->Command = MoveTemp(InCommand);
+	return Action;
+}
+
+USpotifyGetDevicesAction* USpotifyGetDevicesAction::CreateForTest(USpotifyService* InService, TFunction<TFuture<TSpotifyResult<TArray<FSpotifyDevice>>>(USpotifyService&)> InQuery)
+{
+	USpotifyGetDevicesAction* Action = NewObject<USpotifyGetDevicesAction>();
+	Action->Service = InService;
+	Action->Query = MoveTemp(InQuery);
+	return Action;
+}
+#endif
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "SpotifyQueue.h"
+#include "SpotifyResult.h"
+#include "Async/Future.h"
+#include "SpotifyAsyncAction.generated.h"
+
+class USpotifyService;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpotifyCommandDelegate, const FSpotifyError&, Error);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSpotifyDevicesDelegate, const TArray<FSpotifyDevice>&, Devices, const FSpotifyError&, Error);
+
+/**
+ * Latent Blueprint node for a single player command of the Spotify Service.
+ * OnSuccess fires the moment Spotify accepted the command, so the next command can be wired straight after it.
+ */
+UCLASS()
+class SPOTIFY_API USpotifyCommandAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FSpotifyCommandDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FSpotifyCommandDelegate OnFailure;
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyPlay(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyPause(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyNext(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyPrevious(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifySeek(UObject* WorldContextObject, float PositionSeconds);
+
+	// Volume from 0 to 1.
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifySetVolume(UObject* WorldContextObject, float Volume);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyTransferPlayback(UObject* WorldContextObject, const FString& DeviceId, bool bPlay);
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyStartPlayback(UObject* WorldContextObject, const FSpotifyPlayRequest& PlayRequest);
+
+	// Succeeds once every uri was added to the queue (in order).
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyCommandAction* SpotifyEnqueue(UObject* WorldContextObject, const TArray<FString>& Uris);
+
+	virtual void Activate() override;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// Test hook: a node running InCommand against InService, outside of any game instance.
+	static USpotifyCommandAction* CreateForTest(USpotifyService* InService, TFunction<TFuture<TSpotifyResult<void>>(USpotifyService&)> InCommand);
+#endif
+
+private:
+
+	static USpotifyCommandAction* Create(UObject* WorldContextObject, TFunction<TFuture<TSpotifyResult<void>>(USpotifyService&)> InCommand);
+
+	void Finish(const FSpotifyError& Error);
+
+	TWeakObjectPtr<USpotifyService> Service;
+
+	TFunction<TFuture<TSpotifyResult<void>>(USpotifyService&)> Command;
+};
+
+// Latent Blueprint node listing the devices of the active account.
+UCLASS()
+class SPOTIFY_API USpotifyGetDevicesAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FSpotifyDevicesDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FSpotifyDevicesDelegate OnFailure;
+
+	UFUNCTION(BlueprintCallable, Category = "Spotify", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static USpotifyGetDevicesAction* SpotifyGetDevices(UObject* WorldContextObject);
+
+	virtual void Activate() override;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// Test hook: a node answered by InQuery instead of the service's GetDevices, outside of any game instance.
+	static USpotifyGetDevicesAction* CreateForTest(USpotifyService* InService, TFunction<TFuture<TSpotifyResult<TArray<FSpotifyDevice>>>(USpotifyService&)> InQuery);
+#endif
+
+private:
+
+	TWeakObjectPtr<USpotifyService> Service;
+
+	TFunction<TFuture<TSpotifyResult<TArray<FSpotifyDevice>>>(USpotifyService&)> Query;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyAudioAnalysis.h"
+#include "Algo/BinarySearch.h"
+#include "Dom/JsonObject.h"
+
+namespace
+{
+	void ParseStarts(const FJsonObject& Json, const FString& Field, TArray<float>& OutStarts)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Entries;
+		if(!Json.TryGetArrayField(Field, Entries)) return;
+
+		OutStarts.Reserve(Entries->Num());
+		for(const auto& Entry : *Entries)
+		{
+			OutStarts.Add(Entry->AsObject()->GetNumberField("start"));
+		}
+	}
+
+	void ParseValues(const FJsonObject& Segment, const FString& Field, TArray<float>& OutValues)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Values;
+		const int32 Count = Segment.TryGetArrayField(Field, Values) ? Values->Num() : 0;
+		for(int32 i = 0; i < FSpotifyAudioAnalysis::ValuesPerSegment; i++)
+		{
+			OutValues.Add(i < Count ? (*Values)[i]->AsNumber() : 0.f);
+		}
+	}
+}
+
+TSharedPtr<const FSpotifyAudioAnalysis> FSpotifyAudioAnalysis::Parse(const FJsonObject& Json)
+{
+	const TArray<TSharedPtr<FJsonValue>>* Segments;
+	if(!Json.TryGetArrayField("segments", Segments)) return nullptr;
+
+	const TSharedPtr<FSpotifyAudioAnalysis> Analysis = MakeShared<FSpotifyAudioAnalysis>();
+	ParseStarts(Json, "bars", Analysis->BarStarts);
+	ParseStarts(Json, "beats", Analysis->BeatStarts);
+	ParseStarts(Json, "sections", Analysis->SectionStarts);
+
+	Analysis->SegmentStarts.Reserve(Segments->Num());
+	Analysis->SegmentPitches.Reserve(Segments->Num() * ValuesPerSegment);
+	Analysis->SegmentTimbres.Reserve(Segments->Num() * ValuesPerSegment);
+	for(const auto& Entry : *Segments)
+	{
+		const TSharedPtr<FJsonObject> Segment = Entry->AsObject();
+		Analysis->SegmentStarts.Add(Segment->GetNumberField("start"));
+		ParseValues(*Segment, "pitches", Analysis->SegmentPitches);
+		ParseValues(*Segment, "timbre", Analysis->SegmentTimbres);
+	}
+	return Analysis;
+}
+
+void FSpotifyBeatCursor::Reset(TSharedPtr<const FSpotifyAudioAnalysis> InAnalysis)
+{
+	Analysis = InAnalysis;
+	LastTime = 0.f;
+	Bar = Beat = Section = Segment = INDEX_NONE;
+	FMemory::Memzero(Pitches);
+	FMemory::Memzero(Timbre);
+}
+
+FSpotifyBeatCursor::FCrossed FSpotifyBeatCursor::Advance(float Time)
+{
+	FCrossed Crossed;
+	if(!Analysis.IsValid()) return Crossed;
+
+	if(Time < LastTime - JitterThreshold || Time > LastTime + SeekThreshold)
+	{
+		// Seeked, jump straight to the new position without replaying everything in between.
+		Bar = Find(Analysis->BarStarts, Time);
+		Beat = Find(Analysis->BeatStarts, Time);
+		Section = Find(Analysis->SectionStarts, Time);
+		Segment = Find(Analysis->SegmentStarts, Time);
+	}
+	else if(Time >= LastTime)
+	{
+		Crossed.bBar = Step(Analysis->BarStarts, Bar, Time);
+		Crossed.bBeat = Step(Analysis->BeatStarts, Beat, Time);
+		Crossed.bSection = Step(Analysis->SectionStarts, Section, Time);
+		Step(Analysis->SegmentStarts, Segment, Time);
+	}
+	else
+	{
+		// The clock was corrected slightly backwards, hold the cursor until it catches up.
+		return Crossed;
+	}
+
+	LastTime = Time;
+	Interpolate(Time);
+	return Crossed;
+}
+
+bool FSpotifyBeatCursor::Step(const TArray<float>& Starts, int32& Index, float Time)
+{
+	const int32 Previous = Index;
+	while(Starts.IsValidIndex(Index + 1) && Starts[Index + 1] <= Time)
+	{
+		Index++;
+	}
+	return Index != Previous;
+}
+
+int32 FSpotifyBeatCursor::Find(const TArray<float>& Starts, float Time)
+{
+	return Algo::UpperBound(Starts, Time) - 1;
+}
+
+void FSpotifyBeatCursor::Interpolate(float Time)
+{
+	const TArray<float>& Starts = Analysis->SegmentStarts;
+	if(!Starts.IsValidIndex(Segment)) return;
+
+	// Blend towards the next segment, the last one is held.
+	const int32 Next = FMath::Min(Segment + 1, Starts.Num() - 1);
+	const float Length = Starts[Next] - Starts[Segment];
+	const float Alpha = Length > 0.f ? FMath::Clamp((Time - Starts[Segment]) / Length, 0.f, 1.f) : 0.f;
+	const VectorRegister4Float VAlpha = VectorSetFloat1(Alpha);
+
+	const float* FromPitches = Analysis->SegmentPitches.GetData() + Segment * FSpotifyAudioAnalysis::ValuesPerSegment;
+	const float* ToPitches = Analysis->SegmentPitches.GetData() + Next * FSpotifyAudioAnalysis::ValuesPerSegment;
+	const float* FromTimbre = Analysis->SegmentTimbres.GetData() + Segment * FSpotifyAudioAnalysis::ValuesPerSegment;
+	const float* ToTimbre = Analysis->SegmentTimbres.GetData() + Next * FSpotifyAudioAnalysis::ValuesPerSegment;
+
+	for(int32 i = 0; i < FSpotifyAudioAnalysis::ValuesPerSegment; i += 4)
+	{
+		const VectorRegister4Float FromP = VectorLoad(FromPitches + i);
+		const VectorRegister4Float FromT = VectorLoad(FromTimbre + i);
+		VectorStoreAligned(VectorMultiplyAdd(VectorSubtract(VectorLoad(ToPitches + i), FromP), VAlpha, FromP), Pitches + i);
+		VectorStoreAligned(VectorMultiplyAdd(VectorSubtract(VectorLoad(ToTimbre + i), FromT), VAlpha, FromT), Timbre + i);
+	}
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJsonObject;
+
+/**
+ * The audio analysis of a track (GET /audio-analysis/{id}), flattened into plain arrays.
+ * Start times are in seconds and sorted, pitches and timbres are packed ValuesPerSegment floats per segment.
+ */
+struct SPOTIFY_API FSpotifyAudioAnalysis
+{
+	static constexpr int32 ValuesPerSegment = 12;
+
+	TArray<float> BarStarts;
+	TArray<float> BeatStarts;
+	TArray<float> SectionStarts;
+	TArray<float> SegmentStarts;
+
+	TArray<float> SegmentPitches;
+	TArray<float> SegmentTimbres;
+
+	// Builds the analysis from the parsed response, returns nullptr if it is malformed.
+	static TSharedPtr<const FSpotifyAudioAnalysis> Parse(const FJsonObject& Json);
+};
+
+/**
+ * Walks an audio analysis alongside the playback clock.
+ * Advancing is O(1) per frame (the cursor only ever steps to the next boundary) and allocation free,
+ * jumps in the clock are treated as seeks and resolved with a binary search.
+ */
+class SPOTIFY_API FSpotifyBeatCursor
+{
+public:
+
+	// Boundaries crossed by the last Advance.
+	struct FCrossed
+	{
+		bool bBar = false;
+		bool bBeat = false;
+		bool bSection = false;
+	};
+
+	void Reset(TSharedPtr<const FSpotifyAudioAnalysis> InAnalysis);
+
+	// Moves the cursor to Time (seconds into the track) and updates the interpolated pitches and timbre.
+	FCrossed Advance(float Time);
+
+	bool IsValid() const { return Analysis.IsValid(); }
+
+	int32 GetBar() const { return Bar; }
+	int32 GetBeat() const { return Beat; }
+	int32 GetSection() const { return Section; }
+
+	TConstArrayView<float> GetPitches() const { return MakeArrayView(Pitches, FSpotifyAudioAnalysis::ValuesPerSegment); }
+	TConstArrayView<float> GetTimbre() const { return MakeArrayView(Timbre, FSpotifyAudioAnalysis::ValuesPerSegment); }
+
+private:
+
+	// Anything further than this from the last position is considered a seek.
+	static constexpr float SeekThreshold = 2.f;
+
+	// Small backwards corrections of the clock (new poll results) are ignored instead of replayed.
+	static constexpr float JitterThreshold = 0.25f;
+
+	// Steps Index forward over every start <= Time, returns whether it moved.
+	static bool Step(const TArray<float>& Starts, int32& Index, float Time);
+
+	// Index of the last start <= Time (INDEX_NONE if there is none).
+	static int32 Find(const TArray<float>& Starts, float Time);
+
+	void Interpolate(float Time);
+
+	TSharedPtr<const FSpotifyAudioAnalysis> Analysis;
+
+	float LastTime = 0.f;
+
+	int32 Bar = INDEX_NONE;
+	int32 Beat = INDEX_NONE;
+	int32 Section = INDEX_NONE;
+	int32 Segment = INDEX_NONE;
+
+	alignas(16) float Pitches[FSpotifyAudioAnalysis::ValuesPerSegment] = {};
+	alignas(16) float Timbre[FSpotifyAudioAnalysis::ValuesPerSegment] = {};
+};
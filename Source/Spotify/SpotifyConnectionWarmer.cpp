@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyConnectionWarmer.h"
+#include "Spotify.h"
+#include "HttpModule.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Connection Warmups"), STAT_SpotifyConnectionWarmups, STATGROUP_Spotify);
+
+void FSpotifyConnectionWarmer::WarmAll(const FSpotifyRequestTemplates& Templates, double Now, FSendPing SendPing)
+{
+	for(int32 Host = 0; Host < static_cast<int32>(ESpotifyHost::Num); Host++)
+	{
+		Warm(Templates, static_cast<ESpotifyHost>(Host), Now, SendPing);
+	}
+}
+
+double FSpotifyConnectionWarmer::Tick(const FSpotifyRequestTemplates& Templates, double Now, bool bAnyonePlaying, FSendPing SendPing)
+{
+	if(!bAnyonePlaying) return IntervalSeconds;
+
+	double NextCheck = IntervalSeconds;
+	for(int32 Host = 0; Host < static_cast<int32>(ESpotifyHost::Num); Host++)
+	{
+		const double Idle = Now - LastActivity[Host];
+		if(Idle >= IntervalSeconds)
+		{
+			Warm(Templates, static_cast<ESpotifyHost>(Host), Now, SendPing);
+		}
+		else
+		{
+			NextCheck = FMath::Min(NextCheck, IntervalSeconds - Idle);
+		}
+	}
+	return NextCheck;
+}
+
+void FSpotifyConnectionWarmer::Ping(FHttpModule& Http, const FString& Url)
+{
+	const FHttpRequestRef Request = Http.CreateRequest();
+	Request->SetURL(Url);
+	Request->SetVerb(TEXT("HEAD"));
+	Request->ProcessRequest();
+}
+
+void FSpotifyConnectionWarmer::Warm(const FSpotifyRequestTemplates& Templates, ESpotifyHost Host, double Now, FSendPing SendPing)
+{
+	const FString& Origin = Templates.GetOrigin(Host);
+	if(Origin.IsEmpty()) return;
+
+	SendPing(Origin + TEXT("/"));
+
+	Touch(Host, Now);
+	Warmups++;
+	INC_DWORD_STAT(STAT_SpotifyConnectionWarmups);
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpotifyRequestTemplate.h"
+
+class FHttpModule;
+
+/**
+ * Keeps the connections to the API and accounts hosts open so a command after an idle period doesn't pay for
+ * DNS and the TLS handshake. The HTTP module reuses connections per host, so a cheap HEAD to a host that has been
+ * idle for Interval seconds is enough to open (or hold) one. Hosts that see regular traffic are never pinged.
+ * Times are FPlatformTime::Seconds.
+ */
+class SPOTIFY_API FSpotifyConnectionWarmer
+{
+public:
+
+	// 0 disables keeping connections alive (pre-warming still works).
+	void SetInterval(double InIntervalSeconds) { IntervalSeconds = InIntervalSeconds; }
+
+	bool IsEnabled() const { return IntervalSeconds > 0.0; }
+
+	double GetInterval() const { return IntervalSeconds; }
+
+	// A request went to Host, its connection is warm.
+	void Touch(ESpotifyHost Host, double Now) { LastActivity[static_cast<int32>(Host)] = Now; }
+
+	// Sends the request that opens (or holds) a connection to Url, Ping below outside of tests.
+	using FSendPing = TFunctionRef<void(const FString& Url)>;
+
+	// Opens a connection to every host right away.
+	void WarmAll(const FSpotifyRequestTemplates& Templates, double Now, FSendPing SendPing);
+
+	// Pings every host that has been idle for Interval, returns the seconds until the next check.
+	// Nobody playing means nothing is about to be sent, the connections are left to close and it checks back in Interval.
+	double Tick(const FSpotifyRequestTemplates& Templates, double Now, bool bAnyonePlaying, FSendPing SendPing);
+
+	int32 GetWarmups() const { return Warmups; }
+
+	// A HEAD to Url, whatever the host answers doesn't matter, only the connection does.
+	static void Ping(FHttpModule& Http, const FString& Url);
+
+private:
+
+	void Warm(const FSpotifyRequestTemplates& Templates, ESpotifyHost Host, double Now, FSendPing SendPing);
+
+	double IntervalSeconds = 0.0;
+
+	double LastActivity[static_cast<int32>(ESpotifyHost::Num)] = {};
+
+	int32 Warmups = 0;
+};
@@ -24,10 +24,53 @@ public:
 	UPROPERTY(Config, EditDefaultsOnly)
 	FString Callback = TEXT("http://localhost:3036");
 
+	// Base of every Web API request, point it at a local stand-in server for testing.
+	UPROPERTY(Config, EditDefaultsOnly)
+	FString ApiBaseUrl = TEXT("https://api.spotify.com/v1");
+
+	// Base of the authorization and token requests.
+	UPROPERTY(Config, EditDefaultsOnly)
+	FString AccountsBaseUrl = TEXT("https://accounts.spotify.com");
+
+	// Connections to the API and accounts hosts that were idle for this many seconds are pinged to keep them open (0 disables).
+	// Only while an authorized account is playing.
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=0))
+	float KeepAliveInterval = 25.f;
+
 	// The Save game where it saves the Refresh Key.
 	UPROPERTY(Config, EditDefaultsOnly)
 	FString SaveSlotName = TEXT("SpotifyCredentials");
 
+	// Further accounts hosted next to the default one, each is authorized once and saved to "<SaveSlotName>_<Name>".
+	UPROPERTY(Config, EditDefaultsOnly)
+	TArray<FName> AdditionalAccounts;
+
+	// How often (in seconds) the playback info of every account is polled.
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=0.1))
+	float PollInterval = 1.f;
+
+	// Keep an on-disk log of every account's track changes and play spans (Saved/Spotify/<SaveSlot>).
+	UPROPERTY(Config, EditDefaultsOnly)
+	bool bRecordListeningHistory = true;
+
+	// Share of playback info polls that may be duplicated when they take longer than usual (0 disables hedging).
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=0, ClampMax=1))
+	float HedgeBudget = 0.05f;
+
+	// How many queue additions of a bulk enqueue may be sent per second.
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=0.1))
+	float QueueRequestsPerSecond = 10.f;
+
+	// How many queue additions may be in flight at once. Spotify queues in the order requests arrive,
+	// so with a window above 1 the order of the tracks is not guaranteed.
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=1))
+	int32 QueueWindow = 1;
+
+	// Game thread time per frame (in microseconds) for deferred work like broadcasts, artwork uploads and history writes.
+	// What doesn't fit runs next frame, most visible first.
+	UPROPERTY(Config, EditDefaultsOnly, meta=(ClampMin=1))
+	float WorkBudgetMicroseconds = 500.f;
+
 public:
 	
 	virtual FName GetContainerName() const override;
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyHedging.h"
+#include "Spotify.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Playback Hedges"), STAT_SpotifyHedges, STATGROUP_Spotify);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Playback Hedge Wins"), STAT_SpotifyHedgeWins, STATGROUP_Spotify);
+
+void FSpotifyLatencyTracker::Add(double Seconds)
+{
+	Samples[Next] = Seconds;
+	Next = (Next + 1) % Capacity;
+	Count = FMath::Min(Count + 1, Capacity);
+}
+
+double FSpotifyLatencyTracker::GetPercentile(double Percentile) const
+{
+	if(Count == 0) return 0.0;
+
+	TArray<double, TInlineAllocator<Capacity>> Sorted(Samples, Count);
+	Sorted.Sort();
+	return Sorted[FMath::Clamp(FMath::CeilToInt(Percentile * Count) - 1, 0, Count - 1)];
+}
+
+FSpotifyHedgePolicy::FSpotifyHedgePolicy(float InBudgetRatio)
+	: BudgetRatio(InBudgetRatio)
+{
+}
+
+double FSpotifyHedgePolicy::OnRequestSent()
+{
+	Requests++;
+	Credit = FMath::Min(Credit + BudgetRatio, MaxCredit);
+	return GetHedgeDelay();
+}
+
+double FSpotifyHedgePolicy::GetHedgeDelay() const
+{
+	if(BudgetRatio <= 0.f || Latency.Num() < MinSamples) return -1.0;
+
+	return FMath::Max(Latency.GetPercentile(0.95), MinHedgeDelay);
+}
+
+bool FSpotifyHedgePolicy::TryHedge()
+{
+	if(Credit < 1.f) return false;
+
+	Credit -= 1.f;
+	Hedges++;
+	INC_DWORD_STAT(STAT_SpotifyHedges);
+	return true;
+}
+
+void FSpotifyHedgePolicy::OnCompleted(double Seconds, bool bHedgeWon)
+{
+	Latency.Add(Seconds);
+	if(bHedgeWon)
+	{
+		HedgeWins++;
+		INC_DWORD_STAT(STAT_SpotifyHedgeWins);
+	}
+}
+
+FSpotifyHedgeStats FSpotifyHedgePolicy::GetStats() const
+{
+	FSpotifyHedgeStats Stats;
+	Stats.Requests = Requests;
+	Stats.Hedges = Hedges;
+	Stats.HedgeWins = HedgeWins;
+	Stats.HedgeRate = Requests > 0 ? float(Hedges) / Requests : 0.f;
+	Stats.P50Ms = float(Latency.GetPercentile(0.5) * 1000.0);
+	Stats.P95Ms = float(Latency.GetPercentile(0.95) * 1000.0);
+	Stats.P99Ms = float(Latency.GetPercentile(0.99) * 1000.0);
+	Stats.HedgeDelayMs = float(FMath::Max(GetHedgeDelay(), 0.0) * 1000.0);
+	return Stats;
+}
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpotifyHedging.generated.h"
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyHedgeStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Requests = 0;
+
+	// Duplicates that were sent because the first request took longer than the tracked p95.
+	UPROPERTY(BlueprintReadOnly)
+	int32 Hedges = 0;
+
+	// Duplicates that answered first.
+	UPROPERTY(BlueprintReadOnly)
+	int32 HedgeWins = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float HedgeRate = 0.f;
+
+	// Latency as seen by the game (first answer wins), in milliseconds.
+	UPROPERTY(BlueprintReadOnly)
+	float P50Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float P95Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float P99Ms = 0.f;
+
+	// How long a request currently waits before it is hedged, in milliseconds (0 while hedging is off or warming up).
+	UPROPERTY(BlueprintReadOnly)
+	float HedgeDelayMs = 0.f;
+};
+
+// The last Capacity latencies of a request, in seconds.
+class SPOTIFY_API FSpotifyLatencyTracker
+{
+public:
+
+	void Add(double Seconds);
+
+	// Percentile in [0, 1], 0 if there are no samples.
+	double GetPercentile(double Percentile) const;
+
+	int32 Num() const { return Count; }
+
+private:
+
+	static constexpr int32 Capacity = 256;
+
+	double Samples[Capacity] = {};
+
+	int32 Next = 0;
+
+	int32 Count = 0;
+};
+
+/**
+ * Decides when an idempotent read gets a duplicate ("hedge") and keeps the numbers on how that went.
+ * A hedge is sent once the first request is slower than the tracked p95 latency, and only while the budget allows:
+ * every request earns BudgetRatio hedges, so hedges never exceed that share of the traffic.
+ * The p95 is taken over how long the first request of every poll ran. When a hedge wins, the first request is
+ * cancelled and counts with the time it had run by then: that is less than its real latency but still above the
+ * hedge delay, so the tail keeps its share of the samples and the p95 doesn't drift down.
+ */
+class SPOTIFY_API FSpotifyHedgePolicy
+{
+public:
+
+	explicit FSpotifyHedgePolicy(float InBudgetRatio = 0.05f);
+
+	void SetBudgetRatio(float InBudgetRatio) { BudgetRatio = InBudgetRatio; }
+
+	// A request was sent. Returns after how many seconds it should be hedged, or a negative value if it shouldn't.
+	double OnRequestSent();
+
+	// The hedge delay passed without an answer, returns whether the budget allows a hedge.
+	bool TryHedge();
+
+	// The game got its answer Seconds after the first request was sent, from the hedge if bHedgeWon.
+	void OnCompleted(double Seconds, bool bHedgeWon);
+
+	// Seconds a request waits before it is hedged, negative while hedging is off or there are too few samples.
+	double GetHedgeDelay() const;
+
+	FSpotifyHedgeStats GetStats() const;
+
+private:
+
+	// Don't hedge until the tracker knows the latency distribution.
+	static constexpr int32 MinSamples = 16;
+
+	static constexpr double MinHedgeDelay = 0.05;
+
+	// Unused budget is capped so a long quiet period doesn't allow a burst of hedges.
+	static constexpr float MaxCredit = 2.f;
+
+	float BudgetRatio;
+
+	float Credit = 0.f;
+
+	FSpotifyLatencyTracker Latency;
+
+	int32 Requests = 0;
+
+	int32 Hedges = 0;
+
+	int32 HedgeWins = 0;
+};
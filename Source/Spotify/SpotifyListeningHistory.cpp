@@ -0,0 +1,433 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyListeningHistory.h"
+#include "Spotify.h"
+#include "Algo/BinarySearch.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 SegmentMagic = 0x4C485053; // "SPHL"
+	constexpr uint32 SegmentVersion = 1;
+	constexpr int64 HeaderBytes = 8;
+	constexpr int64 MsPerHour = 60 * 60 * 1000;
+
+	// Reads from a mapped segment without ever running past its end.
+	struct FRecordCursor
+	{
+		const uint8* Data;
+		int64 Size;
+		int64 Offset = 0;
+
+		template<typename T>
+		bool Read(T& Value)
+		{
+			if(Offset + int64(sizeof(T)) > Size) return false;
+			FMemory::Memcpy(&Value, Data + Offset, sizeof(T));
+			Offset += sizeof(T);
+			return true;
+		}
+
+		bool ReadName(FString& Value)
+		{
+			uint16 Length;
+			if(!Read(Length) || Offset + Length > Size) return false;
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data + Offset), Length);
+			Value = FString(Converted.Length(), Converted.Get());
+			Offset += Length;
+			return true;
+		}
+	};
+
+	int64 FloorDiv(int64 Value, int64 Divisor)
+	{
+		return Value >= 0 ? Value / Divisor : -((-Value + Divisor - 1) / Divisor);
+	}
+}
+
+FSpotifyListeningHistory::~FSpotifyListeningHistory()
+{
+	Close();
+}
+
+bool FSpotifyListeningHistory::Open(const FString& InDirectory)
+{
+	Close();
+	Directory = InDirectory;
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Directory / TEXT("segment_*.bin")), true, false);
+	TArray<int32> Numbers;
+	for(const FString& File : Files)
+	{
+		int32 Number;
+		if(LexTryParseString(Number, *FPaths::GetBaseFilename(File).RightChop(8)))
+		{
+			Numbers.Add(Number);
+		}
+	}
+	Numbers.Sort();
+
+	TArray<int32> LocalNameIds;
+	int64 ValidBytes = 0;
+	for(const int32 Number : Numbers)
+	{
+		FSegment& Segment = Segments.AddDefaulted_GetRef();
+		Segment.Number = Number;
+		ValidBytes = LoadSegment(Segment, LocalNameIds);
+	}
+
+	// Continue the newest segment unless it is full or ends in a torn record.
+	if(Segments.Num() > 0 && ValidBytes >= HeaderBytes && ValidBytes < MaxSegmentBytes
+		&& ValidBytes == IFileManager::Get().FileSize(*GetSegmentPath(Segments.Last().Number)))
+	{
+		WriteHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*GetSegmentPath(Segments.Last().Number), true, false));
+		WriteOffset = ValidBytes;
+		for(int32 Local = 0; Local < LocalNameIds.Num(); Local++)
+		{
+			LocalNames.Add(LocalNameIds[Local], Local);
+		}
+		return IsOpen();
+	}
+	return StartSegment(Segments.Num() > 0 ? Segments.Last().Number + 1 : 0);
+}
+
+void FSpotifyListeningHistory::Close()
+{
+	WriteHandle.Reset();
+	WriteOffset = 0;
+	LocalNames.Reset();
+	PendingLocalNames.Reset();
+	Segments.Reset();
+	Names.Reset();
+	NameIds.Reset();
+	SongNames.Reset();
+}
+
+FString FSpotifyListeningHistory::GetSegmentPath(int32 Number) const
+{
+	return Directory / FString::Printf(TEXT("segment_%08d.bin"), Number);
+}
+
+int64 FSpotifyListeningHistory::LoadSegment(FSegment& Segment, TArray<int32>& OutLocalNames)
+{
+	OutLocalNames.Reset();
+	const FString Path = GetSegmentPath(Segment.Number);
+	if(IFileManager::Get().FileSize(*Path) < HeaderBytes) return 0;
+
+	const TUniquePtr<IMappedFileHandle> Mapping(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+	if(!Mapping) return 0;
+	const TUniquePtr<IMappedFileRegion> Region(Mapping->MapRegion(0, Mapping->GetFileSize()));
+	if(!Region) return 0;
+
+	FRecordCursor Cursor{Region->GetMappedPtr(), Region->GetMappedSize()};
+	uint32 Magic, Version;
+	if(!Cursor.Read(Magic) || !Cursor.Read(Version) || Magic != SegmentMagic || Version != SegmentVersion)
+	{
+		UE_LOG(LogSpotify, Warning, TEXT("Skipping unknown history segment %s"), *Path);
+		return 0;
+	}
+
+	// Only advanced past complete records.
+	int64 ValidBytes = Cursor.Offset;
+	auto ToGlobal = [&OutLocalNames](uint32 Local) { return OutLocalNames.IsValidIndex(Local) ? OutLocalNames[Local] : INDEX_NONE; };
+	while(true)
+	{
+		uint8 Type;
+		if(!Cursor.Read(Type)) break;
+
+		bool bComplete = false;
+		switch(static_cast<ERecord>(Type))
+		{
+		case ERecord::Name:
+		{
+			FString Value;
+			if((bComplete = Cursor.ReadName(Value)))
+			{
+				OutLocalNames.Add(InternName(Value));
+			}
+			break;
+		}
+		case ERecord::Track:
+		{
+			int64 TimeMs;
+			uint32 SongId, SongName, Artist;
+			uint8 bPreviousSkipped;
+			if((bComplete = Cursor.Read(TimeMs) && Cursor.Read(SongId) && Cursor.Read(SongName) && Cursor.Read(Artist) && Cursor.Read(bPreviousSkipped)))
+			{
+				SongNames.Add(ToGlobal(SongId), ToGlobal(SongName));
+				AddTrack(Segment, TimeMs, ToGlobal(SongId), ToGlobal(Artist), bPreviousSkipped != 0);
+			}
+			break;
+		}
+		case ERecord::Span:
+		{
+			int64 StartMs;
+			int32 ListenedMs;
+			uint32 SongId, SongName, Artist;
+			if((bComplete = Cursor.Read(StartMs) && Cursor.Read(ListenedMs) && Cursor.Read(SongId) && Cursor.Read(SongName) && Cursor.Read(Artist)))
+			{
+				SongNames.Add(ToGlobal(SongId), ToGlobal(SongName));
+				AddSpan(Segment, StartMs, ListenedMs, ToGlobal(SongId), ToGlobal(Artist));
+			}
+			break;
+		}
+		}
+		if(!bComplete) break;
+		ValidBytes = Cursor.Offset;
+	}
+	return ValidBytes;
+}
+
+bool FSpotifyListeningHistory::StartSegment(int32 Number)
+{
+	WriteHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*GetSegmentPath(Number), false, false));
+	if(!WriteHandle) return false;
+
+	FSegment& Segment = Segments.AddDefaulted_GetRef();
+	Segment.Number = Number;
+	LocalNames.Reset();
+	WriteOffset = 0;
+
+	TArray<uint8> Header;
+	FMemoryWriter Writer(Header);
+	uint32 Magic = SegmentMagic, Version = SegmentVersion;
+	Writer << Magic << Version;
+	Append(Header);
+	return true;
+}
+
+bool FSpotifyListeningHistory::Append(const TArray<uint8>& Record)
+{
+	if(!WriteHandle->Write(Record.GetData(), Record.Num())) return false;
+	WriteHandle->Flush();
+	WriteOffset += Record.Num();
+	return true;
+}
+
+bool FSpotifyListeningHistory::WriteRecord(const TArray<uint8>& Record)
+{
+	if(!Append(Record))
+	{
+		// The segment may end in part of the record now, seal it, loading drops the torn tail.
+		UE_LOG(LogSpotify, Warning, TEXT("Failed to write listening history to %s"), *GetSegmentPath(Segments.Last().Number));
+		PendingLocalNames.Reset();
+		StartSegment(Segments.Last().Number + 1);
+		return false;
+	}
+	for(const int32 Id : PendingLocalNames)
+	{
+		LocalNames.Add(Id, LocalNames.Num());
+	}
+	PendingLocalNames.Reset();
+	return true;
+}
+
+void FSpotifyListeningHistory::RotateIfFull()
+{
+	if(WriteOffset >= MaxSegmentBytes)
+	{
+		StartSegment(Segments.Last().Number + 1);
+	}
+}
+
+int32 FSpotifyListeningHistory::InternName(FStringView Value)
+{
+	FString Key(Value);
+	if(const int32* Id = NameIds.Find(Key)) return *Id;
+	const int32 Id = Names.Add(Key);
+	NameIds.Add(MoveTemp(Key), Id);
+	return Id;
+}
+
+uint32 FSpotifyListeningHistory::GetLocalName(FStringView Value, FArchive& Writer)
+{
+	const int32 Id = InternName(Value);
+	if(const uint32* Local = LocalNames.Find(Id)) return *Local;
+	const int32 Pending = PendingLocalNames.Find(Id);
+	if(Pending != INDEX_NONE) return LocalNames.Num() + Pending;
+
+	const uint32 Local = LocalNames.Num() + PendingLocalNames.Add(Id);
+
+	const FTCHARToUTF8 Converted(Value.GetData(), Value.Len());
+	uint8 Type = static_cast<uint8>(ERecord::Name);
+	uint16 Length = static_cast<uint16>(FMath::Min(Converted.Length(), int32(MAX_uint16)));
+	Writer << Type << Length;
+	Writer.Serialize(const_cast<ANSICHAR*>(Converted.Get()), Length);
+	return Local;
+}
+
+void FSpotifyListeningHistory::RecordTrack(int64 TimeMs, FStringView SongId, FStringView SongName, FStringView Artist, bool bPreviousSkipped)
+{
+	if(!IsOpen()) return;
+	RotateIfFull();
+
+	TArray<uint8> Record;
+	FMemoryWriter Writer(Record);
+	uint32 LocalSongId = GetLocalName(SongId, Writer);
+	uint32 LocalSongName = GetLocalName(SongName, Writer);
+	uint32 LocalArtist = GetLocalName(Artist, Writer);
+	uint8 Type = static_cast<uint8>(ERecord::Track);
+	uint8 Skipped = bPreviousSkipped ? 1 : 0;
+	Writer << Type << TimeMs << LocalSongId << LocalSongName << LocalArtist << Skipped;
+	if(!WriteRecord(Record)) return;
+
+	const int32 SongKey = InternName(SongId);
+	SongNames.Add(SongKey, InternName(SongName));
+	AddTrack(Segments.Last(), TimeMs, SongKey, InternName(Artist), bPreviousSkipped);
+}
+
+void FSpotifyListeningHistory::RecordSpan(int64 StartMs, int32 ListenedMs, FStringView SongId, FStringView SongName, FStringView Artist)
+{
+	if(!IsOpen() || ListenedMs <= 0) return;
+	RotateIfFull();
+
+	TArray<uint8> Record;
+	FMemoryWriter Writer(Record);
+	uint32 LocalSongId = GetLocalName(SongId, Writer);
+	uint32 LocalSongName = GetLocalName(SongName, Writer);
+	uint32 LocalArtist = GetLocalName(Artist, Writer);
+	uint8 Type = static_cast<uint8>(ERecord::Span);
+	Writer << Type << StartMs << ListenedMs << LocalSongId << LocalSongName << LocalArtist;
+	if(!WriteRecord(Record)) return;
+
+	const int32 SongKey = InternName(SongId);
+	SongNames.Add(SongKey, InternName(SongName));
+	AddSpan(Segments.Last(), StartMs, ListenedMs, SongKey, InternName(Artist));
+}
+
+FSpotifyListeningHistory::FBucket& FSpotifyListeningHistory::GetBucket(FSegment& Segment, int64 TimeMs)
+{
+	const int64 Hour = FloorDiv(TimeMs, MsPerHour);
+	if(Segment.Buckets.Num() > 0 && Segment.Buckets.Last().Hour == Hour) return Segment.Buckets.Last();
+
+	const int32 Index = Algo::LowerBoundBy(Segment.Buckets, Hour, &FBucket::Hour);
+	if(!Segment.Buckets.IsValidIndex(Index) || Segment.Buckets[Index].Hour != Hour)
+	{
+		Segment.Buckets.Insert(FBucket(), Index);
+		Segment.Buckets[Index].Hour = Hour;
+	}
+	return Segment.Buckets[Index];
+}
+
+void FSpotifyListeningHistory::AddTrack(FSegment& Segment, int64 TimeMs, int32 SongId, int32 Artist, bool bPreviousSkipped)
+{
+	for(FBucket* Bucket : {&GetBucket(Segment, TimeMs), &Segment.Summary})
+	{
+		Bucket->Plays++;
+		Bucket->Skips += bPreviousSkipped ? 1 : 0;
+		Bucket->Tracks.FindOrAdd(SongId).Plays++;
+		Bucket->Artists.FindOrAdd(Artist).Plays++;
+	}
+}
+
+void FSpotifyListeningHistory::AddSpan(FSegment& Segment, int64 StartMs, int32 ListenedMs, int32 SongId, int32 Artist)
+{
+	// Spans are at most a track long, they are counted in the hour they started in.
+	for(FBucket* Bucket : {&GetBucket(Segment, StartMs), &Segment.Summary})
+	{
+		Bucket->ListenedMs += ListenedMs;
+		Bucket->Tracks.FindOrAdd(SongId).ListenedMs += ListenedMs;
+		Bucket->Artists.FindOrAdd(Artist).ListenedMs += ListenedMs;
+	}
+}
+
+template<typename FuncType>
+void FSpotifyListeningHistory::ForEachSummary(const FDateTime& From, const FDateTime& To, FuncType&& Visit) const
+{
+	const int64 FromHour = FloorDiv(ToUnixMs(From), MsPerHour);
+	const int64 ToHour = FloorDiv(ToUnixMs(To) + MsPerHour - 1, MsPerHour);
+	for(const FSegment& Segment : Segments)
+	{
+		if(Segment.Buckets.Num() == 0 || Segment.Buckets.Last().Hour < FromHour || Segment.Buckets[0].Hour >= ToHour) continue;
+		if(Segment.Buckets[0].Hour >= FromHour && Segment.Buckets.Last().Hour < ToHour)
+		{
+			Visit(Segment.Summary);
+			continue;
+		}
+		for(int32 Index = Algo::LowerBoundBy(Segment.Buckets, FromHour, &FBucket::Hour); Index < Segment.Buckets.Num() && Segment.Buckets[Index].Hour < ToHour; Index++)
+		{
+			Visit(Segment.Buckets[Index]);
+		}
+	}
+}
+
+TArray<FSpotifyHistoryEntry> FSpotifyListeningHistory::GetTop(const FDateTime& From, const FDateTime& To, int32 Count, bool bArtists) const
+{
+	TMap<int32, FTally> Totals;
+	ForEachSummary(From, To, [&Totals, bArtists](const FBucket& Bucket)
+	{
+		for(const auto& Pair : bArtists ? Bucket.Artists : Bucket.Tracks)
+		{
+			FTally& Total = Totals.FindOrAdd(Pair.Key);
+			Total.Plays += Pair.Value.Plays;
+			Total.ListenedMs += Pair.Value.ListenedMs;
+		}
+	});
+	Totals.ValueSort([](const FTally& A, const FTally& B) { return A.ListenedMs != B.ListenedMs ? A.ListenedMs > B.ListenedMs : A.Plays > B.Plays; });
+
+	TArray<FSpotifyHistoryEntry> Entries;
+	for(const auto& Pair : Totals)
+	{
+		if(Entries.Num() >= Count) break;
+		if(!Names.IsValidIndex(Pair.Key)) continue;
+		FSpotifyHistoryEntry& Entry = Entries.AddDefaulted_GetRef();
+		if(bArtists)
+		{
+			Entry.Name = Names[Pair.Key];
+		}
+		else
+		{
+			const int32* SongName = SongNames.Find(Pair.Key);
+			Entry.Name = SongName && Names.IsValidIndex(*SongName) ? Names[*SongName] : FString();
+			Entry.Id = Names[Pair.Key];
+		}
+		Entry.Plays = Pair.Value.Plays;
+		Entry.ListenedSeconds = Pair.Value.ListenedMs / 1000.f;
+	}
+	return Entries;
+}
+
+TArray<FSpotifyHistoryEntry> FSpotifyListeningHistory::GetTopTracks(const FDateTime& From, const FDateTime& To, int32 Count) const
+{
+	return GetTop(From, To, Count, false);
+}
+
+TArray<FSpotifyHistoryEntry> FSpotifyListeningHistory::GetTopArtists(const FDateTime& From, const FDateTime& To, int32 Count) const
+{
+	return GetTop(From, To, Count, true);
+}
+
+double FSpotifyListeningHistory::GetListeningSeconds(const FDateTime& From, const FDateTime& To) const
+{
+	int64 ListenedMs = 0;
+	ForEachSummary(From, To, [&ListenedMs](const FBucket& Bucket) { ListenedMs += Bucket.ListenedMs; });
+	return ListenedMs / 1000.0;
+}
+
+float FSpotifyListeningHistory::GetSkipRate(const FDateTime& From, const FDateTime& To) const
+{
+	int32 Plays = 0, Skips = 0;
+	ForEachSummary(From, To, [&Plays, &Skips](const FBucket& Bucket)
+	{
+		Plays += Bucket.Plays;
+		Skips += Bucket.Skips;
+	});
+	return Plays > 0 ? float(Skips) / Plays : 0.f;
+}
+
+int64 FSpotifyListeningHistory::ToUnixMs(const FDateTime& Time)
+{
+	return (Time - FDateTime(1970, 1, 1)).GetTicks() / ETimespan::TicksPerMillisecond;
+}
+
+int64 FSpotifyListeningHistory::NowUnixMs()
+{
+	return ToUnixMs(FDateTime::UtcNow());
+}
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "SpotifyListeningHistory.generated.h"
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyHistoryEntry
+{
+	GENERATED_BODY()
+
+	// Song or artist name.
+	UPROPERTY(BlueprintReadOnly)
+	FString Name;
+
+	// Song Id, empty for artists.
+	UPROPERTY(BlueprintReadOnly)
+	FString Id;
+
+	// How often it was started.
+	UPROPERTY(BlueprintReadOnly)
+	int32 Plays = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float ListenedSeconds = 0.f;
+};
+
+/**
+ * Append-only log of what an account listened to.
+ * Every track change and every play span (play until pause or track change) is appended as a small binary record
+ * to the newest segment file, a segment is sealed once it grows past MaxSegmentBytes and a new one is started.
+ * Sealed segments are never written again and are read through a memory mapping once, when the history is opened.
+ * While records are appended they are also folded into hourly summaries and a summary of their whole segment.
+ * The aggregate queries only ever add up summaries (so windows are rounded to whole hours) and never touch the raw
+ * records: a segment inside the window counts with its segment summary, only segments on the window's edges are
+ * added up hour by hour.
+ * Game thread only.
+ */
+class SPOTIFY_API FSpotifyListeningHistory
+{
+public:
+
+	FSpotifyListeningHistory() = default;
+	FSpotifyListeningHistory(FSpotifyListeningHistory&&) = default;
+	FSpotifyListeningHistory& operator=(FSpotifyListeningHistory&&) = default;
+	~FSpotifyListeningHistory();
+
+	static constexpr int64 MaxSegmentBytes = 256 * 1024;
+
+	// Loads the summaries of every segment in Directory and continues the newest one.
+	bool Open(const FString& InDirectory);
+
+	void Close();
+
+	bool IsOpen() const { return WriteHandle.IsValid(); }
+
+	// A new track started, bPreviousSkipped tells whether the one before was left early.
+	void RecordTrack(int64 TimeMs, FStringView SongId, FStringView SongName, FStringView Artist, bool bPreviousSkipped);
+
+	// The track was played from StartMs for ListenedMs.
+	void RecordSpan(int64 StartMs, int32 ListenedMs, FStringView SongId, FStringView SongName, FStringView Artist);
+
+	// Most listened tracks or artists (by listening time) between From and To (UTC).
+	TArray<FSpotifyHistoryEntry> GetTopTracks(const FDateTime& From, const FDateTime& To, int32 Count) const;
+
+	TArray<FSpotifyHistoryEntry> GetTopArtists(const FDateTime& From, const FDateTime& To, int32 Count) const;
+
+	double GetListeningSeconds(const FDateTime& From, const FDateTime& To) const;
+
+	// Share of the track changes between From and To that left the previous track before it ended.
+	float GetSkipRate(const FDateTime& From, const FDateTime& To) const;
+
+	// Milliseconds since the unix epoch, what records are timestamped with.
+	static int64 ToUnixMs(const FDateTime& Time);
+
+	static int64 NowUnixMs();
+
+private:
+
+	enum class ERecord : uint8
+	{
+		// Defines the next name id of the segment.
+		Name,
+		Track,
+		Span
+	};
+
+	struct FTally
+	{
+		int32 Plays = 0;
+		int64 ListenedMs = 0;
+	};
+
+	// Everything that happened in one hour, keys are ids in Names.
+	struct FBucket
+	{
+		int64 Hour = 0;
+		int64 ListenedMs = 0;
+		int32 Plays = 0;
+		int32 Skips = 0;
+		TMap<int32, FTally> Tracks;
+		TMap<int32, FTally> Artists;
+	};
+
+	struct FSegment
+	{
+		int32 Number = 0;
+		// Sorted by hour.
+		TArray<FBucket> Buckets;
+		// All buckets added up, Hour is unused.
+		FBucket Summary;
+	};
+
+	FString GetSegmentPath(int32 Number) const;
+
+	// Reads a segment through a memory mapping and folds its records into its summary.
+	// Returns how many bytes were valid, a torn last record is left out.
+	int64 LoadSegment(FSegment& Segment, TArray<int32>& OutLocalNames);
+
+	bool StartSegment(int32 Number);
+
+	bool Append(const TArray<uint8>& Record);
+
+	// Appends a record built with GetLocalName, keeps the new local names only if it was written.
+	bool WriteRecord(const TArray<uint8>& Record);
+
+	// Starts the next segment once the current one is full.
+	void RotateIfFull();
+
+	// Id of Value in the history wide name table.
+	int32 InternName(FStringView Value);
+
+	// Segment local id of the name, writes a Name record for it ahead of the record if it wasn't used in this segment yet.
+	uint32 GetLocalName(FStringView Value, FArchive& Writer);
+
+	FBucket& GetBucket(FSegment& Segment, int64 TimeMs);
+
+	void AddTrack(FSegment& Segment, int64 TimeMs, int32 SongId, int32 Artist, bool bPreviousSkipped);
+
+	void AddSpan(FSegment& Segment, int64 StartMs, int32 ListenedMs, int32 SongId, int32 Artist);
+
+	// Calls Visit with the summaries that add up to the window between From and To.
+	template<typename FuncType>
+	void ForEachSummary(const FDateTime& From, const FDateTime& To, FuncType&& Visit) const;
+
+	TArray<FSpotifyHistoryEntry> GetTop(const FDateTime& From, const FDateTime& To, int32 Count, bool bArtists) const;
+
+	FString Directory;
+
+	TArray<FSegment> Segments;
+
+	// Names (song ids, song names and artists) of all segments.
+	TArray<FString> Names;
+
+	TMap<FString, int32> NameIds;
+
+	// Display name of every song id.
+	TMap<int32, int32> SongNames;
+
+	TUniquePtr<IFileHandle> WriteHandle;
+
+	int64 WriteOffset = 0;
+
+	// Name id to segment local id of the segment that is written to.
+	TMap<int32, uint32> LocalNames;
+
+	// Names the record being built introduces, they get the local ids following LocalNames.
+	TArray<int32> PendingLocalNames;
+};
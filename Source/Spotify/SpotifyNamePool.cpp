@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyNamePool.h"
+#include "Spotify.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Name Pool Hits"), STAT_SpotifyNamePoolHits, STATGROUP_Spotify);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Name Pool Misses"), STAT_SpotifyNamePoolMisses, STATGROUP_Spotify);
+
+FSpotifyNamePool::FSpotifyNamePool(int32 InMaxEntries)
+	: MaxEntries(FMath::Max(1, InMaxEntries))
+{
+	Reset();
+}
+
+FSpotifyNameHandle FSpotifyNamePool::Intern(FStringView Value)
+{
+	const uint32 Hash = HashValue(Value);
+	int32 Index = FindEntry(Value, Hash);
+	if(Index != INDEX_NONE)
+	{
+		Hits++;
+		INC_DWORD_STAT(STAT_SpotifyNamePoolHits);
+	}
+	else
+	{
+		Misses++;
+		INC_DWORD_STAT(STAT_SpotifyNamePoolMisses);
+
+		Index = Entries.Num() < MaxEntries ? INDEX_NONE : Evict();
+		if(Index == INDEX_NONE)
+		{
+			UE_CLOG(Entries.Num() == MaxEntries, LogSpotify, Warning, TEXT("Name pool is full of referenced names, growing past %d."), MaxEntries);
+			Index = Entries.AddDefaulted();
+		}
+
+		// Reset keeps the recycled string's allocation around.
+		FEntry& Entry = Entries[Index];
+		Entry.Value.Reset();
+		Entry.Value.Append(Value.GetData(), Value.Len());
+		Entry.Hash = Hash;
+		int32& Head = Buckets[Hash & (Buckets.Num() - 1)];
+		Entry.NextInBucket = Head;
+		Head = Index;
+	}
+
+	Entries[Index].RefCount++;
+	FSpotifyNameHandle Handle;
+	Handle.Index = Index;
+	return Handle;
+}
+
+bool FSpotifyNamePool::Assign(FSpotifyNameHandle& Handle, FStringView Value)
+{
+	if(Handle.IsValid() && Equals(Entries[Handle.Index].Value, Value))
+	{
+		Hits++;
+		INC_DWORD_STAT(STAT_SpotifyNamePoolHits);
+		return false;
+	}
+
+	// Intern first, releasing first could recycle the entry we are about to look up.
+	const FSpotifyNameHandle NewHandle = Intern(Value);
+	Release(Handle);
+	Handle = NewHandle;
+	return true;
+}
+
+void FSpotifyNamePool::Release(FSpotifyNameHandle& Handle)
+{
+	if(Handle.IsValid())
+	{
+		check(Entries[Handle.Index].RefCount > 0);
+		Entries[Handle.Index].RefCount--;
+		Handle.Index = INDEX_NONE;
+	}
+}
+
+const FString& FSpotifyNamePool::Get(FSpotifyNameHandle Handle) const
+{
+	static const FString Empty;
+	return Handle.IsValid() ? Entries[Handle.Index].Value : Empty;
+}
+
+void FSpotifyNamePool::Reset()
+{
+	Entries.Reset();
+	Buckets.Init(INDEX_NONE, FMath::RoundUpToPowerOfTwo(MaxEntries));
+	ClockHand = 0;
+}
+
+uint32 FSpotifyNamePool::HashValue(FStringView Value)
+{
+	return FCrc::MemCrc32(Value.GetData(), Value.Len() * sizeof(TCHAR));
+}
+
+bool FSpotifyNamePool::Equals(const FString& A, FStringView B)
+{
+	return A.Len() == B.Len() && FMemory::Memcmp(*A, B.GetData(), B.Len() * sizeof(TCHAR)) == 0;
+}
+
+int32 FSpotifyNamePool::FindEntry(FStringView Value, uint32 Hash) const
+{
+	for(int32 Index = Buckets[Hash & (Buckets.Num() - 1)]; Index != INDEX_NONE; Index = Entries[Index].NextInBucket)
+	{
+		if(Entries[Index].Hash == Hash && Equals(Entries[Index].Value, Value))
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 FSpotifyNamePool::Evict()
+{
+	for(int32 Step = 0; Step < Entries.Num(); Step++)
+	{
+		const int32 Index = ClockHand;
+		ClockHand = (ClockHand + 1) % Entries.Num();
+		if(Entries[Index].RefCount == 0)
+		{
+			Unlink(Index);
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FSpotifyNamePool::Unlink(int32 Index)
+{
+	int32* Link = &Buckets[Entries[Index].Hash & (Buckets.Num() - 1)];
+	while(*Link != Index)
+	{
+		Link = &Entries[*Link].NextInBucket;
+	}
+	*Link = Entries[Index].NextInBucket;
+	Entries[Index].NextInBucket = INDEX_NONE;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// A stable reference to a string held by FSpotifyNamePool, compares as an integer.
+struct FSpotifyNameHandle
+{
+	int32 Index = INDEX_NONE;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+
+	bool operator==(const FSpotifyNameHandle& Other) const { return Index == Other.Index; }
+	bool operator!=(const FSpotifyNameHandle& Other) const { return Index != Other.Index; }
+};
+
+/**
+ * Interns the Spotify IDs and display names seen by the service so repeated values resolve to the same handle.
+ * Handles are reference counted. Unreferenced strings stay cached (and keep their allocation) until the pool is
+ * full, then they are recycled in clock order, so a steady poll neither allocates nor grows the pool.
+ * Game thread only.
+ */
+class SPOTIFY_API FSpotifyNamePool
+{
+public:
+
+	explicit FSpotifyNamePool(int32 InMaxEntries = 1024);
+
+	// Returns the handle of Value and adds a reference to it.
+	FSpotifyNameHandle Intern(FStringView Value);
+
+	// Points Handle at Value, releasing what it pointed at before. Returns whether the value changed.
+	// If Handle already holds Value this is a single string compare, no hashing and no allocation.
+	bool Assign(FSpotifyNameHandle& Handle, FStringView Value);
+
+	// Drops a reference and invalidates Handle.
+	void Release(FSpotifyNameHandle& Handle);
+
+	const FString& Get(FSpotifyNameHandle Handle) const;
+
+	void Reset();
+
+	int32 Num() const { return Entries.Num(); }
+
+	uint64 GetHits() const { return Hits; }
+	uint64 GetMisses() const { return Misses; }
+
+private:
+
+	struct FEntry
+	{
+		FString Value;
+		uint32 Hash = 0;
+		int32 RefCount = 0;
+		int32 NextInBucket = INDEX_NONE;
+	};
+
+	static uint32 HashValue(FStringView Value);
+
+	static bool Equals(const FString& A, FStringView B);
+
+	int32 FindEntry(FStringView Value, uint32 Hash) const;
+
+	// Picks an unreferenced entry to reuse, INDEX_NONE if every entry is referenced.
+	int32 Evict();
+
+	void Unlink(int32 Index);
+
+	int32 MaxEntries;
+
+	TArray<FEntry> Entries;
+
+	// Heads of the hash chains, sized for MaxEntries.
+	TArray<int32> Buckets;
+
+	int32 ClockHand = 0;
+
+	uint64 Hits = 0;
+
+	uint64 Misses = 0;
+};
@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyPlayerWidget.h"
+#include "Spotify.h"
+#include "HttpModule.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Async/Async.h"
+#include "Components/Image.h"
+#include "Components/ProgressBar.h"
+#include "Components/TextBlock.h"
+#include "Engine/GameInstance.h"
+#include "Engine/Texture2D.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Modules/ModuleManager.h"
+
+void USpotifyPlayerWidget::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	const UGameInstance* GameInstance = GetGameInstance();
+	USpotifyService* SpotifyService = GameInstance ? GameInstance->GetSubsystem<USpotifyService>() : nullptr;
+	Service = SpotifyService;
+	if(!SpotifyService) return;
+
+	PlaybackChangedHandle = SpotifyService->OnPlaybackChanged.AddUObject(this, &USpotifyPlayerWidget::HandlePlaybackChanged);
+	HandlePlaybackChanged(ESpotifyPlaybackFields::All);
+}
+
+void USpotifyPlayerWidget::NativeDestruct()
+{
+	if(USpotifyService* SpotifyService = Service.Get())
+	{
+		SpotifyService->OnPlaybackChanged.Remove(PlaybackChangedHandle);
+	}
+	PlaybackChangedHandle.Reset();
+	SetTicking(false);
+	CancelArtwork();
+	ShownPercent = -1.f;
+	ShownSeconds = -1;
+
+	Super::NativeDestruct();
+}
+
+void USpotifyPlayerWidget::HandlePlaybackChanged(ESpotifyPlaybackFields Fields)
+{
+	const USpotifyService* SpotifyService = Service.Get();
+	if(!SpotifyService) return;
+
+	if(SongName && EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::SongName))
+	{
+		SongName->SetText(FText::FromString(SpotifyService->GetSongName()));
+	}
+	if(Artists && EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::Artists))
+	{
+		Artists->SetText(FText::FromString(SpotifyService->JoinArtistNames(*ArtistSeparator)));
+	}
+	if(AlbumName && EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::AlbumName))
+	{
+		AlbumName->SetText(FText::FromString(SpotifyService->GetAlbumName()));
+	}
+	if(DurationText && EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::Duration))
+	{
+		DurationText->SetText(FormatTime(SpotifyService->GetPlaybackDuration() / 1000));
+	}
+	if(Artwork && EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::AlbumImage))
+	{
+		RequestArtwork(SpotifyService->GetAlbumImageUrl());
+	}
+	if(EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::PlayState | ESpotifyPlaybackFields::Duration | ESpotifyPlaybackFields::Position))
+	{
+		UpdateProgress(true);
+	}
+	if(EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::PlayState))
+	{
+		SetTicking(SpotifyService->IsPlaying());
+	}
+	if(EnumHasAnyFlags(Fields, ESpotifyPlaybackFields::SongName | ESpotifyPlaybackFields::Artists | ESpotifyPlaybackFields::AlbumName))
+	{
+		OnSongChanged();
+	}
+}
+
+bool USpotifyPlayerWidget::TickProgress(float DeltaTime)
+{
+	UpdateProgress(false);
+	return true;
+}
+
+void USpotifyPlayerWidget::UpdateProgress(bool bForce)
+{
+	const USpotifyService* SpotifyService = Service.Get();
+	if(!SpotifyService) return;
+
+	const float Duration = SpotifyService->GetPlaybackDuration() / 1000.f;
+	const float Position = FMath::Min(SpotifyService->GetPlaybackPosition(), Duration);
+
+	if(Progress)
+	{
+		const float Percent = Duration > 0.f ? Position / Duration : 0.f;
+		if(bForce || FMath::Abs(Percent - ShownPercent) >= ProgressStep)
+		{
+			Progress->SetPercent(Percent);
+			ShownPercent = Percent;
+		}
+	}
+	const int32 Seconds = FMath::FloorToInt(Position);
+	if(PositionText && (bForce || Seconds != ShownSeconds))
+	{
+		PositionText->SetText(FormatTime(Seconds));
+		ShownSeconds = Seconds;
+	}
+}
+
+void USpotifyPlayerWidget::SetTicking(bool bTicking)
+{
+	if(bTicking == ProgressTicker.IsValid()) return;
+
+	if(bTicking)
+	{
+		ProgressTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &USpotifyPlayerWidget::TickProgress), ProgressInterval);
+	}
+	else
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(ProgressTicker);
+		ProgressTicker.Reset();
+	}
+}
+
+void USpotifyPlayerWidget::RequestArtwork(const FString& Url)
+{
+	if(Url == ArtworkUrl) return;
+
+	CancelArtwork();
+	ArtworkUrl = Url;
+	if(Url.IsEmpty())
+	{
+		ArtworkTexture = nullptr;
+		Artwork->SetBrushFromTexture(nullptr);
+		return;
+	}
+
+	ArtworkRequest = FHttpModule::Get().CreateRequest();
+	ArtworkRequest->SetURL(Url);
+	ArtworkRequest->SetVerb(TEXT("GET"));
+	ArtworkRequest->OnProcessRequestComplete().BindUObject(this, &USpotifyPlayerWidget::ReceiveArtwork);
+	ArtworkRequest->ProcessRequest();
+}
+
+void USpotifyPlayerWidget::ReceiveArtwork(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+{
+	if(Request != ArtworkRequest) return;
+	ArtworkRequest.Reset();
+
+	if(!bWasSuccessful || !Response.IsValid() || Response->GetResponseCode() != 200)
+	{
+		UE_LOG(LogSpotify, Warning, TEXT("Couldn't download the album art %s"), *Request->GetURL());
+		return;
+	}
+
+	// The module has to be loaded on the game thread, decoding a cover doesn't have to happen there.
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<USpotifyPlayerWidget>(this), Response, &ImageWrapperModule, Url = ArtworkUrl]()
+	{
+		const TArray<uint8>& Content = Response->GetContent();
+		const EImageFormat Format = ImageWrapperModule.DetectImageFormat(Content.GetData(), Content.Num());
+		const TSharedPtr<IImageWrapper> ImageWrapper = Format != EImageFormat::Invalid ? ImageWrapperModule.CreateImageWrapper(Format) : nullptr;
+
+		TArray64<uint8> Pixels;
+		if(!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Content.GetData(), Content.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Pixels))
+		{
+			UE_LOG(LogSpotify, Warning, TEXT("Couldn't decode the album art %s"), *Url);
+			return;
+		}
+
+		const int32 Width = ImageWrapper->GetWidth();
+		const int32 Height = ImageWrapper->GetHeight();
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Url, Width, Height, Pixels = MoveTemp(Pixels)]() mutable
+		{
+			// Creating and uploading the texture counts against the service's frame budget.
+			USpotifyPlayerWidget* This = WeakThis.Get();
+			USpotifyService* SpotifyService = This ? This->Service.Get() : nullptr;
+			if(!SpotifyService) return;
+
+			SpotifyService->QueueGameThreadWork(ESpotifyWorkPriority::UserVisible, [WeakThis, Url, Width, Height, Pixels = MoveTemp(Pixels)]()
+			{
+				// A newer song may have asked for a different cover in the meantime.
+				USpotifyPlayerWidget* Widget = WeakThis.Get();
+				if(Widget && Widget->ArtworkUrl == Url)
+				{
+					Widget->ApplyArtwork(Width, Height, Pixels);
+				}
+			});
+		});
+	});
+}
+
+void USpotifyPlayerWidget::ApplyArtwork(int32 Width, int32 Height, const TArray64<uint8>& Pixels)
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if(!Texture || !Artwork) return;
+
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	void* Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(Data, Pixels.GetData(), FMath::Min<int64>(Pixels.Num(), Mip.BulkData.GetBulkDataSize()));
+	Mip.BulkData.Unlock();
+	Texture->UpdateResource();
+
+	ArtworkTexture = Texture;
+	Artwork->SetBrushFromTexture(Texture);
+}
+
+void USpotifyPlayerWidget::CancelArtwork()
+{
+	if(ArtworkRequest.IsValid())
+	{
+		ArtworkRequest->OnProcessRequestComplete().Unbind();
+		ArtworkRequest->CancelRequest();
+		ArtworkRequest.Reset();
+	}
+	ArtworkUrl.Reset();
+}
+
+FText USpotifyPlayerWidget::FormatTime(int32 Seconds)
+{
+	return FText::FromString(FString::Printf(TEXT("%d:%02d"), Seconds / 60, Seconds % 60));
+}
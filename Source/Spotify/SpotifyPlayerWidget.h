@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IHttpRequest.h"
+#include "SpotifyService.h"
+#include "SpotifyPlayerWidget.generated.h"
+
+class UImage;
+class UProgressBar;
+class UTextBlock;
+class UTexture2D;
+
+/**
+ * Base class for player widgets, binds to the Spotify Service natively instead of through Blueprint ticks.
+ * Every bound widget is only touched when its field changed (OnPlaybackChanged), the progress bar runs off the
+ * interpolated playback clock on a core ticker that only exists while a song plays. Nothing is volatile or bound
+ * with attributes, so the widget stays cached inside invalidation and retainer panels between updates.
+ * Name the child widgets like the members below, all of them are optional.
+ */
+UCLASS(Abstract)
+class SPOTIFY_API USpotifyPlayerWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+protected:
+
+	virtual void NativeConstruct() override;
+
+	virtual void NativeDestruct() override;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UTextBlock* SongName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UTextBlock* Artists;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UTextBlock* AlbumName;
+
+	// Position as m:ss, updated once per second.
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UTextBlock* PositionText;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UTextBlock* DurationText;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UProgressBar* Progress;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spotify", meta = (BindWidgetOptional))
+	UImage* Artwork;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Spotify")
+	FString ArtistSeparator = TEXT(", ");
+
+	// Smallest change of the progress bar (0 to 1) that is pushed to it, smaller steps wouldn't move a pixel.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Spotify", meta = (ClampMin = "0"))
+	float ProgressStep = 0.001f;
+
+	// Seconds between progress updates while playing, 0 updates every frame.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Spotify", meta = (ClampMin = "0"))
+	float ProgressInterval = 0.f;
+
+	// Called after the bound widgets were updated for a new song.
+	UFUNCTION(BlueprintImplementableEvent, Category = "Spotify")
+	void OnSongChanged();
+
+private:
+
+	void HandlePlaybackChanged(ESpotifyPlaybackFields Fields);
+
+	bool TickProgress(float DeltaTime);
+
+	void UpdateProgress(bool bForce);
+
+	void SetTicking(bool bTicking);
+
+	void RequestArtwork(const FString& Url);
+
+	void ReceiveArtwork(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+
+	void ApplyArtwork(int32 Width, int32 Height, const TArray64<uint8>& Pixels);
+
+	void CancelArtwork();
+
+	static FText FormatTime(int32 Seconds);
+
+	TWeakObjectPtr<USpotifyService> Service;
+
+	FDelegateHandle PlaybackChangedHandle;
+
+	FTSTicker::FDelegateHandle ProgressTicker;
+
+	// What the widgets show, so nothing is pushed twice.
+	float ShownPercent = -1.f;
+	int32 ShownSeconds = -1;
+
+	FString ArtworkUrl;
+
+	FHttpRequestPtr ArtworkRequest;
+
+	UPROPERTY(Transient)
+	UTexture2D* ArtworkTexture = nullptr;
+};
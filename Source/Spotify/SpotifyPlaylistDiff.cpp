@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyPlaylistDiff.h"
+#include "Algo/BinarySearch.h"
+
+TArray<FSpotifyPlaylistMutation> FSpotifyPlaylistDiff::Compute(const TArray<FString>& Current, const TArray<FString>& Target)
+{
+	// Every target slot a uri should end up in, in ascending order.
+	TMap<FString, TArray<int32>> Slots;
+	Slots.Reserve(Target.Num());
+	for(int32 Slot = 0; Slot < Target.Num(); Slot++)
+	{
+		Slots.FindOrAdd(Target[Slot]).Add(Slot);
+	}
+
+	// The first N occurrences of a uri are kept (and mapped to its N target slots), every other one is removed.
+	TMap<FString, int32> Used;
+	TArray<int32> Removed;
+	TArray<int32> Order;
+	Order.Reserve(Current.Num());
+	TBitArray<> bPresent(false, Target.Num());
+	for(int32 Index = 0; Index < Current.Num(); Index++)
+	{
+		const TArray<int32>* UriSlots = Slots.Find(Current[Index]);
+		int32& Count = Used.FindOrAdd(Current[Index]);
+		if(!UriSlots || Count >= UriSlots->Num())
+		{
+			Removed.Add(Index);
+			continue;
+		}
+		const int32 Slot = (*UriSlots)[Count++];
+		Order.Add(Slot);
+		bPresent[Slot] = true;
+	}
+
+	// Unavailable tracks have no uri and can't be removed by one, only a rewrite gets rid of them.
+	for(const int32 Index : Removed)
+	{
+		if(Current[Index].IsEmpty())
+		{
+			return Replace(Target);
+		}
+	}
+
+	TArray<FSpotifyPlaylistMutation> Mutations;
+
+	// Remove back to front, this way the positions of later batches stay valid once earlier ones are applied.
+	for(int32 End = Removed.Num(); End > 0; End -= MaxUrisPerRequest)
+	{
+		const int32 Begin = FMath::Max(0, End - MaxUrisPerRequest);
+		FSpotifyPlaylistMutation& Mutation = Mutations.AddDefaulted_GetRef();
+		Mutation.Op = ESpotifyPlaylistOp::Remove;
+		for(int32 i = End - 1; i >= Begin; i--)
+		{
+			Mutation.Uris.Add(Current[Removed[i]]);
+			Mutation.Positions.Add(Removed[i]);
+		}
+	}
+
+	// Everything on the longest increasing subsequence is already in order and never moves.
+	const TBitArray<> bStable = LongestIncreasingSubsequence(Order, Target.Num());
+
+	// Walk the target in order; every slot before Slot is already placed correctly relative to the stable ones,
+	// so a run of misplaced tracks goes right behind the last placed one.
+	int32 LastPlaced = INDEX_NONE;
+	for(int32 Slot = 0; Slot < Target.Num();)
+	{
+		if(!bPresent[Slot] || bStable[Slot])
+		{
+			LastPlaced = bPresent[Slot] ? Slot : LastPlaced;
+			Slot++;
+			continue;
+		}
+
+		const int32 From = Order.Find(Slot);
+		int32 Length = 1;
+		while(From + Length < Order.Num() && Order[From + Length] == Slot + Length && !bStable[Slot + Length])
+		{
+			Length++;
+		}
+
+		const int32 InsertBefore = LastPlaced == INDEX_NONE ? 0 : Order.Find(LastPlaced) + 1;
+		if(InsertBefore != From)
+		{
+			FSpotifyPlaylistMutation& Mutation = Mutations.AddDefaulted_GetRef();
+			Mutation.Op = ESpotifyPlaylistOp::Reorder;
+			Mutation.RangeStart = From;
+			Mutation.RangeLength = Length;
+			Mutation.InsertBefore = InsertBefore;
+
+			const TArray<int32> Range(Order.GetData() + From, Length);
+			Order.RemoveAt(From, Length, false);
+			Order.Insert(Range, InsertBefore > From ? InsertBefore - Length : InsertBefore);
+		}
+
+		LastPlaced = Slot + Length - 1;
+		Slot += Length;
+	}
+
+	// Order now holds the present slots sorted, so every missing run is inserted exactly at its slot.
+	for(int32 Slot = 0; Slot < Target.Num();)
+	{
+		if(bPresent[Slot])
+		{
+			Slot++;
+			continue;
+		}
+
+		FSpotifyPlaylistMutation& Mutation = Mutations.AddDefaulted_GetRef();
+		Mutation.Op = ESpotifyPlaylistOp::Add;
+		Mutation.Position = Slot;
+		while(Slot < Target.Num() && !bPresent[Slot] && Mutation.Uris.Num() < MaxUrisPerRequest)
+		{
+			Mutation.Uris.Add(Target[Slot++]);
+		}
+	}
+
+	// A full rewrite costs one request per 100 tracks, take it if the edit script is longer.
+	const int32 ReplaceCost = FMath::Max(1, FMath::DivideAndRoundUp(Target.Num(), MaxUrisPerRequest));
+	if(Mutations.Num() > ReplaceCost)
+	{
+		return Replace(Target);
+	}
+	return Mutations;
+}
+
+TBitArray<> FSpotifyPlaylistDiff::LongestIncreasingSubsequence(const TArray<int32>& Values, int32 NumSlots)
+{
+	// Patience sorting: Tails[k] is the index of the smallest tail of an increasing run of length k + 1.
+	TArray<int32> Tails;
+	TArray<int32> Previous;
+	Previous.Init(INDEX_NONE, Values.Num());
+	for(int32 Index = 0; Index < Values.Num(); Index++)
+	{
+		const int32 Length = Algo::LowerBoundBy(Tails, Values[Index], [&Values](int32 Tail) { return Values[Tail]; });
+		if(Length > 0)
+		{
+			Previous[Index] = Tails[Length - 1];
+		}
+		if(Length == Tails.Num())
+		{
+			Tails.Add(Index);
+		}
+		else
+		{
+			Tails[Length] = Index;
+		}
+	}
+
+	TBitArray<> bStable(false, NumSlots);
+	for(int32 Index = Tails.Num() > 0 ? Tails.Last() : INDEX_NONE; Index != INDEX_NONE; Index = Previous[Index])
+	{
+		bStable[Values[Index]] = true;
+	}
+	return bStable;
+}
+
+TArray<FSpotifyPlaylistMutation> FSpotifyPlaylistDiff::Replace(const TArray<FString>& Target)
+{
+	TArray<FSpotifyPlaylistMutation> Mutations;
+
+	FSpotifyPlaylistMutation& First = Mutations.AddDefaulted_GetRef();
+	First.Op = ESpotifyPlaylistOp::Replace;
+	First.Uris.Append(Target.GetData(), FMath::Min(Target.Num(), MaxUrisPerRequest));
+
+	for(int32 Slot = MaxUrisPerRequest; Slot < Target.Num(); Slot += MaxUrisPerRequest)
+	{
+		FSpotifyPlaylistMutation& Mutation = Mutations.AddDefaulted_GetRef();
+		Mutation.Op = ESpotifyPlaylistOp::Add;
+		Mutation.Position = Slot;
+		Mutation.Uris.Append(Target.GetData() + Slot, FMath::Min(Target.Num() - Slot, MaxUrisPerRequest));
+	}
+	return Mutations;
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// The kind of a single playlist edit, each maps onto one Spotify Web API call.
+enum class ESpotifyPlaylistOp : uint8
+{
+	// DELETE /playlists/{id}/tracks (Uris at Positions).
+	Remove,
+	// PUT /playlists/{id}/tracks (RangeStart, RangeLength, InsertBefore).
+	Reorder,
+	// POST /playlists/{id}/tracks (Uris inserted at Position).
+	Add,
+	// PUT /playlists/{id}/tracks (Uris replace the whole playlist).
+	Replace
+};
+
+struct FSpotifyPlaylistMutation
+{
+	ESpotifyPlaylistOp Op = ESpotifyPlaylistOp::Add;
+
+	// Remove, Add and Replace: the affected track uris.
+	TArray<FString> Uris;
+
+	// Remove: the position of each uri in Uris.
+	TArray<int32> Positions;
+
+	// Add: where the uris are inserted.
+	int32 Position = 0;
+
+	// Reorder: the range that is moved and where it is moved to (positions before the move).
+	int32 RangeStart = 0;
+	int32 RangeLength = 0;
+	int32 InsertBefore = 0;
+};
+
+// A running playlist synchronisation, owned by the Spotify Service.
+struct FSpotifyPlaylistSync
+{
+	FString PlaylistId;
+
+	// Index of the account the playlist belongs to.
+	int32 Account = 0;
+
+	// The tracks the playlist should contain once we are done.
+	TArray<FString> Target;
+
+	// The tracks the playlist contains right now (filled while paging through the playlist).
+	TArray<FString> Current;
+
+	// Every mutation is sent against the snapshot returned by the previous one.
+	FString SnapshotId;
+
+	TArray<FSpotifyPlaylistMutation> Mutations;
+
+	int32 NextMutation = 0;
+};
+
+/**
+ * Computes a minimal, batched edit script that turns one track list into another.
+ * Surplus tracks are removed, the remaining ones are brought into order by moving as few
+ * contiguous ranges as possible (everything on the longest increasing subsequence stays put),
+ * and missing tracks are inserted in runs. If rewriting the playlist takes fewer requests, or
+ * Current holds unavailable tracks (empty uris) that would have to be removed, the script falls back to a replace.
+ * Pure function, safe to call on a worker thread.
+ */
+class SPOTIFY_API FSpotifyPlaylistDiff
+{
+public:
+
+	// Spotify accepts at most 100 uris per playlist request.
+	static constexpr int32 MaxUrisPerRequest = 100;
+
+	static TArray<FSpotifyPlaylistMutation> Compute(const TArray<FString>& Current, const TArray<FString>& Target);
+
+private:
+
+	// Marks every value on a longest increasing subsequence of Values (values are unique slots < NumSlots).
+	static TBitArray<> LongestIncreasingSubsequence(const TArray<int32>& Values, int32 NumSlots);
+
+	static TArray<FSpotifyPlaylistMutation> Replace(const TArray<FString>& Target);
+};
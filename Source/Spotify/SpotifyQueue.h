@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "SpotifyResult.h"
+#include "SpotifyQueue.generated.h"
+
+// What to start playing, sent as a single PUT /me/player/play.
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyPlayRequest
+{
+	GENERATED_BODY()
+
+	// Album, artist or playlist uri. Takes precedence over Uris.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString ContextUri;
+
+	// Track uris to play (if there is no ContextUri).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FString> Uris;
+
+	// Where to start inside the context or the uris, either by position or by uri. Position < 0 and an empty uri start at the top.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 OffsetPosition = -1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString OffsetUri;
+
+	// Where to start inside the first track.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 PositionMs = 0;
+};
+
+// A running bulk enqueue, owned by the Spotify Service.
+struct FSpotifyQueueBatch
+{
+	// Index of the account the tracks are queued for.
+	int32 Account = 0;
+
+	TArray<FString> Uris;
+
+	// Next uri that was never sent.
+	int32 NextToSend = 0;
+
+	// Uris that were rate limited and are sent again before NextToSend.
+	TArray<int32> Retries;
+
+	TArray<uint8> Attempts;
+
+	// Result of every uri, set as the answers come in (in any order).
+	TArray<TOptional<FSpotifyError>> Results;
+
+	// Results are reported strictly in order, this is the first one that wasn't.
+	int32 NextToComplete = 0;
+
+	// Called in order for every uri once it and all uris before it were answered.
+	TFunction<void(int32 Index, const FSpotifyError& Error)> OnItemCompleted;
+
+	// Ok if every uri was queued, the first error in order otherwise.
+	TPromise<TSpotifyResult<void>> Promise;
+
+	FSpotifyError FirstError;
+
+	bool IsSent() const { return NextToSend == Uris.Num() && Retries.Num() == 0; }
+};
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyRateLimiter.h"
+
+FSpotifyRateLimiter::FSpotifyRateLimiter(float InRate, float InBurst)
+{
+	Configure(InRate, InBurst);
+}
+
+void FSpotifyRateLimiter::Configure(float InRate, float InBurst)
+{
+	Rate = FMath::Max(InRate, 0.01f);
+	Burst = FMath::Max(InBurst, 1.f);
+	Tokens = Burst;
+}
+
+bool FSpotifyRateLimiter::TryAcquire(double Now)
+{
+	if(Now < BlockedUntil) return false;
+
+	Refill(Now);
+	if(Tokens < 1.0) return false;
+
+	Tokens -= 1.0;
+	return true;
+}
+
+double FSpotifyRateLimiter::GetWaitSeconds(double Now) const
+{
+	if(Now < BlockedUntil) return BlockedUntil - Now;
+
+	const double Available = FMath::Min<double>(Burst, Tokens + (Now - LastRefill) * Rate);
+	return Available >= 1.0 ? 0.0 : (1.0 - Available) / Rate;
+}
+
+void FSpotifyRateLimiter::BlockFor(double Now, double RetryAfterSeconds)
+{
+	BlockedUntil = FMath::Max(BlockedUntil, Now + RetryAfterSeconds);
+	Tokens = 0.0;
+	LastRefill = BlockedUntil;
+}
+
+void FSpotifyRateLimiter::Refill(double Now)
+{
+	if(Now <= LastRefill) return;
+
+	Tokens = FMath::Min<double>(Burst, Tokens + (Now - LastRefill) * Rate);
+	LastRefill = Now;
+}
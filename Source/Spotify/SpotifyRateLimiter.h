@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Token bucket in front of bursts of Web API requests (e.g. bulk queue additions).
+ * Tokens refill at Rate per second up to Burst. A 429 answer blocks the bucket for the Retry-After the server sent.
+ * Times are FPlatformTime::Seconds.
+ */
+class SPOTIFY_API FSpotifyRateLimiter
+{
+public:
+
+	explicit FSpotifyRateLimiter(float InRate = 10.f, float InBurst = 10.f);
+
+	void Configure(float InRate, float InBurst);
+
+	// Takes a token if one is available.
+	bool TryAcquire(double Now);
+
+	// Seconds until the next token is available, 0 if one is available now.
+	double GetWaitSeconds(double Now) const;
+
+	// The server asked us to back off, nothing is handed out for RetryAfterSeconds and the bucket starts empty.
+	void BlockFor(double Now, double RetryAfterSeconds);
+
+private:
+
+	void Refill(double Now);
+
+	float Rate;
+
+	float Burst;
+
+	double Tokens;
+
+	double LastRefill = 0.0;
+
+	double BlockedUntil = 0.0;
+};
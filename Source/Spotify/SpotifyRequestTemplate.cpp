@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyRequestTemplate.h"
+#include "HttpModule.h"
+#include "SpotifyResponseDecoder.h"
+
+void FSpotifyRequestTemplates::Build(const FString& ApiBaseUrl, const FString& AccountsBaseUrl)
+{
+	auto Set = [this](ESpotifyEndpoint Endpoint, const TCHAR* Verb, FString Url, ESpotifyHost Host, bool bCompressed, const TCHAR* ContentType = TEXT(""))
+	{
+		FSpotifyRequestTemplate& Template = Templates[static_cast<int32>(Endpoint)];
+		Template.Verb = Verb;
+		Template.Url = MoveTemp(Url);
+		Template.ContentType = ContentType;
+		Template.Host = Host;
+		Template.bCompressed = bCompressed;
+	};
+
+	const TCHAR* Json = TEXT("application/json");
+	Set(ESpotifyEndpoint::Token, TEXT("POST"), AccountsBaseUrl + TEXT("/api/token"), ESpotifyHost::Accounts, false, TEXT("application/x-www-form-urlencoded;charset=UTF-8"));
+	Set(ESpotifyEndpoint::PlaybackState, TEXT("GET"), ApiBaseUrl + TEXT("/me/player?market=from_token"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Play, TEXT("PUT"), ApiBaseUrl + TEXT("/me/player/play"), ESpotifyHost::Api, true, Json);
+	Set(ESpotifyEndpoint::Pause, TEXT("PUT"), ApiBaseUrl + TEXT("/me/player/pause"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Next, TEXT("POST"), ApiBaseUrl + TEXT("/me/player/next"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Previous, TEXT("POST"), ApiBaseUrl + TEXT("/me/player/previous"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Seek, TEXT("PUT"), ApiBaseUrl + TEXT("/me/player/seek?position_ms="), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Volume, TEXT("PUT"), ApiBaseUrl + TEXT("/me/player/volume?volume_percent="), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Transfer, TEXT("PUT"), ApiBaseUrl + TEXT("/me/player"), ESpotifyHost::Api, true, Json);
+	Set(ESpotifyEndpoint::Devices, TEXT("GET"), ApiBaseUrl + TEXT("/me/player/devices"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Queue, TEXT("POST"), ApiBaseUrl + TEXT("/me/player/queue?uri="), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::AudioAnalysis, TEXT("GET"), ApiBaseUrl + TEXT("/audio-analysis/"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::Playlist, TEXT("GET"), ApiBaseUrl + TEXT("/playlists/"), ESpotifyHost::Api, true);
+	Set(ESpotifyEndpoint::PlaylistRemove, TEXT("DELETE"), ApiBaseUrl + TEXT("/playlists/"), ESpotifyHost::Api, true, Json);
+	Set(ESpotifyEndpoint::PlaylistUpdate, TEXT("PUT"), ApiBaseUrl + TEXT("/playlists/"), ESpotifyHost::Api, true, Json);
+	Set(ESpotifyEndpoint::PlaylistAdd, TEXT("POST"), ApiBaseUrl + TEXT("/playlists/"), ESpotifyHost::Api, true, Json);
+
+	Origins[static_cast<int32>(ESpotifyHost::Api)] = GetOriginOf(ApiBaseUrl);
+	Origins[static_cast<int32>(ESpotifyHost::Accounts)] = GetOriginOf(AccountsBaseUrl);
+}
+
+FHttpRequestRef FSpotifyRequestTemplates::Create(FHttpModule& Http, ESpotifyEndpoint Endpoint, const FString* Authorization, FStringView Suffix) const
+{
+	const FSpotifyRequestTemplate& Template = Get(Endpoint);
+	FString Url;
+	Url.Reserve(Template.Url.Len() + Suffix.Len());
+	Url.Append(Template.Url);
+	Url.Append(Suffix.GetData(), Suffix.Len());
+	return CreateForUrl(Http, Endpoint, Authorization, Url);
+}
+
+FHttpRequestRef FSpotifyRequestTemplates::CreateForUrl(FHttpModule& Http, ESpotifyEndpoint Endpoint, const FString* Authorization, const FString& Url) const
+{
+	const FSpotifyRequestTemplate& Template = Get(Endpoint);
+	FHttpRequestRef Request = Http.CreateRequest();
+	Request->SetURL(Url);
+	Request->SetVerb(Template.Verb);
+	if(Authorization)
+	{
+		Request->SetHeader(TEXT("Authorization"), *Authorization);
+	}
+	if(Template.bCompressed)
+	{
+		Request->SetHeader(TEXT("Accept-Encoding"), FSpotifyResponseDecoder::AcceptEncoding);
+	}
+	if(!Template.ContentType.IsEmpty())
+	{
+		Request->SetHeader(TEXT("Content-Type"), Template.ContentType);
+	}
+	return Request;
+}
+
+FString FSpotifyRequestTemplates::GetOriginOf(const FString& Url)
+{
+	// scheme://host[:port] without the path.
+	const int32 HostStart = Url.Find(TEXT("://"));
+	const int32 PathStart = HostStart != INDEX_NONE ? Url.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, HostStart + 3) : INDEX_NONE;
+	return PathStart != INDEX_NONE ? Url.Left(PathStart) : Url;
+}
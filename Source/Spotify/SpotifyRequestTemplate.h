@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpRequest.h"
+
+class FHttpModule;
+
+// Every Web API and accounts endpoint the service talks to.
+enum class ESpotifyEndpoint : uint8
+{
+	Token,
+	PlaybackState,
+	Play,
+	Pause,
+	Next,
+	Previous,
+	Seek,
+	Volume,
+	Transfer,
+	Devices,
+	Queue,
+	AudioAnalysis,
+	Playlist,
+	PlaylistRemove,
+	PlaylistUpdate,
+	PlaylistAdd,
+	Num
+};
+
+// The hosts requests go to, connections to each are kept warm separately.
+enum class ESpotifyHost : uint8
+{
+	Api,
+	Accounts,
+	Num
+};
+
+/**
+ * Prebuilt, immutable description of one endpoint: verb, url (or url prefix) and the fixed headers.
+ * Building a request from it only appends the per call suffix, no formatting.
+ */
+struct FSpotifyRequestTemplate
+{
+	FString Verb;
+
+	FString Url;
+
+	// Empty if the request has no body.
+	FString ContentType;
+
+	ESpotifyHost Host = ESpotifyHost::Api;
+
+	// Whether the response is decoded through FSpotifyResponseDecoder (and may be compressed).
+	bool bCompressed = false;
+};
+
+/**
+ * The templates of every endpoint, built once from the configured base urls.
+ */
+class SPOTIFY_API FSpotifyRequestTemplates
+{
+public:
+
+	void Build(const FString& ApiBaseUrl, const FString& AccountsBaseUrl);
+
+	const FSpotifyRequestTemplate& Get(ESpotifyEndpoint Endpoint) const { return Templates[static_cast<int32>(Endpoint)]; }
+
+	// Scheme and host of Host, what connections are warmed against.
+	const FString& GetOrigin(ESpotifyHost Host) const { return Origins[static_cast<int32>(Host)]; }
+
+	// Creates a request for Endpoint with Suffix appended to its url. Authorization is the cached header of the account, if any.
+	FHttpRequestRef Create(FHttpModule& Http, ESpotifyEndpoint Endpoint, const FString* Authorization, FStringView Suffix = FStringView()) const;
+
+	// Same, but for an absolute url handed out by the API (e.g. the next page of a list).
+	FHttpRequestRef CreateForUrl(FHttpModule& Http, ESpotifyEndpoint Endpoint, const FString* Authorization, const FString& Url) const;
+
+private:
+
+	static FString GetOriginOf(const FString& Url);
+
+	FSpotifyRequestTemplate Templates[static_cast<int32>(ESpotifyEndpoint::Num)];
+
+	FString Origins[static_cast<int32>(ESpotifyHost::Num)];
+};
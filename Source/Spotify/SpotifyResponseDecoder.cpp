@@ -0,0 +1,292 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyResponseDecoder.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+const TCHAR* FSpotifyResponseDecoder::AcceptEncoding = TEXT("gzip, deflate");
+
+namespace
+{
+	enum class EBodyEncoding : uint8
+	{
+		Identity,
+		// zlib or gzip framing, zlib tells them apart by itself.
+		Framed,
+		RawDeflate
+	};
+
+	EBodyEncoding DetectEncoding(const IHttpResponse& Response, const TArray<uint8>& Body)
+	{
+		const FString ContentEncoding = Response.GetHeader(TEXT("Content-Encoding"));
+		if(ContentEncoding.IsEmpty() || Body.Num() < 2) return EBodyEncoding::Identity;
+
+		// The HTTP backend may already have inflated the body, so trust the bytes over the header.
+		if(Body[0] == 0x1F && Body[1] == 0x8B) return EBodyEncoding::Framed;
+		if((Body[0] & 0x0F) == Z_DEFLATED && ((Body[0] << 8) | Body[1]) % 31 == 0) return EBodyEncoding::Framed;
+		if(ContentEncoding.Contains(TEXT("deflate")) && Body[0] != '{' && Body[0] != '[') return EBodyEncoding::RawDeflate;
+		return EBodyEncoding::Identity;
+	}
+
+	/**
+	 * Reads the body as TCHARs: inflates a chunk at a time and decodes UTF-8 on the fly,
+	 * so neither the inflated body nor a string of it ever exists in full.
+	 */
+	class FDecodingArchive final : public FArchive
+	{
+	public:
+
+		FDecodingArchive(const TArray<uint8>& InSource, EBodyEncoding InEncoding)
+			: Source(InSource)
+			, Encoding(InEncoding)
+		{
+			SetIsLoading(true);
+			FMemory::Memzero(Stream);
+			if(Encoding != EBodyEncoding::Identity)
+			{
+				Stream.next_in = const_cast<Bytef*>(Source.GetData());
+				Stream.avail_in = Source.Num();
+				bInflating = inflateInit2(&Stream, Encoding == EBodyEncoding::RawDeflate ? -MAX_WBITS : MAX_WBITS + 32) == Z_OK;
+				if(!bInflating)
+				{
+					SetError();
+					bInputDone = true;
+				}
+			}
+		}
+
+		virtual ~FDecodingArchive() override
+		{
+			if(bInflating)
+			{
+				inflateEnd(&Stream);
+			}
+		}
+
+		virtual void Serialize(void* Data, int64 Num) override
+		{
+			TCHAR* Out = static_cast<TCHAR*>(Data);
+			for(int64 Remaining = Num / sizeof(TCHAR); Remaining > 0; Remaining--)
+			{
+				if(CharsBegin == CharsEnd && !Refill())
+				{
+					SetError();
+					FMemory::Memzero(Out, Remaining * sizeof(TCHAR));
+					return;
+				}
+				*Out++ = Chars[CharsBegin++];
+				Position++;
+			}
+		}
+
+		virtual bool AtEnd() override
+		{
+			return CharsBegin == CharsEnd && !Refill();
+		}
+
+		virtual int64 Tell() override
+		{
+			return Position;
+		}
+
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FSpotifyDecodingArchive");
+		}
+
+		int64 GetDecodedBytes() const
+		{
+			return DecodedBytes;
+		}
+
+	private:
+
+		static constexpr int32 ChunkSize = 16 * 1024;
+
+		// Decodes the next chunk into Chars, returns false once everything was read.
+		bool Refill()
+		{
+			CharsBegin = CharsEnd = 0;
+			while(CharsEnd == 0)
+			{
+				if(bInputDone && BytesBegin == BytesEnd) return false;
+				if(!bInputDone)
+				{
+					FillBytes();
+				}
+				DecodeBytes();
+			}
+			return true;
+		}
+
+		// Appends raw or inflated bytes behind the (at most 3 bytes of) undecoded UTF-8 still in the buffer.
+		void FillBytes()
+		{
+			const int32 Leftover = BytesEnd - BytesBegin;
+			FMemory::Memmove(Bytes, Bytes + BytesBegin, Leftover);
+			BytesBegin = 0;
+			BytesEnd = Leftover;
+
+			int32 Produced;
+			if(Encoding == EBodyEncoding::Identity)
+			{
+				Produced = FMath::Min(ChunkSize - BytesEnd, Source.Num() - SourceOffset);
+				FMemory::Memcpy(Bytes + BytesEnd, Source.GetData() + SourceOffset, Produced);
+				SourceOffset += Produced;
+				bInputDone = SourceOffset == Source.Num();
+			}
+			else
+			{
+				Stream.next_out = Bytes + BytesEnd;
+				Stream.avail_out = ChunkSize - BytesEnd;
+				const int Result = inflate(&Stream, Z_NO_FLUSH);
+				Produced = (ChunkSize - BytesEnd) - Stream.avail_out;
+				if(Result == Z_STREAM_END || (Produced == 0 && Stream.avail_in == 0 && Stream.avail_out > 0))
+				{
+					bInputDone = true;
+				}
+				else if(Result != Z_OK && Result != Z_BUF_ERROR)
+				{
+					SetError();
+					bInputDone = true;
+				}
+			}
+			BytesEnd += Produced;
+			DecodedBytes += Produced;
+		}
+
+		void DecodeBytes()
+		{
+			// Leave room for a surrogate pair.
+			while(BytesBegin < BytesEnd && CharsEnd < ChunkSize - 1)
+			{
+				const uint8 Lead = Bytes[BytesBegin];
+				const int32 Length = Lead < 0x80 ? 1 : (Lead >> 5) == 0x06 ? 2 : (Lead >> 4) == 0x0E ? 3 : (Lead >> 3) == 0x1E ? 4 : 0;
+				if(Length == 0)
+				{
+					Emit(0xFFFD);
+					BytesBegin++;
+					continue;
+				}
+				if(BytesBegin + Length > BytesEnd)
+				{
+					// The rest of the sequence comes with the next chunk, unless there is none.
+					if(bInputDone)
+					{
+						Emit(0xFFFD);
+						BytesBegin = BytesEnd;
+					}
+					return;
+				}
+
+				uint32 CodePoint = Length == 1 ? Lead : Lead & (0x7F >> Length);
+				int32 Index = 1;
+				for(; Index < Length && (Bytes[BytesBegin + Index] & 0xC0) == 0x80; Index++)
+				{
+					CodePoint = (CodePoint << 6) | (Bytes[BytesBegin + Index] & 0x3F);
+				}
+				if(Index != Length)
+				{
+					Emit(0xFFFD);
+					BytesBegin++;
+					continue;
+				}
+				BytesBegin += Length;
+				Emit(CodePoint);
+			}
+		}
+
+		void Emit(uint32 CodePoint)
+		{
+			if(sizeof(TCHAR) == 2 && CodePoint > 0xFFFF)
+			{
+				CodePoint -= 0x10000;
+				Chars[CharsEnd++] = static_cast<TCHAR>(0xD800 + (CodePoint >> 10));
+				Chars[CharsEnd++] = static_cast<TCHAR>(0xDC00 + (CodePoint & 0x3FF));
+				return;
+			}
+			Chars[CharsEnd++] = static_cast<TCHAR>(CodePoint);
+		}
+
+		const TArray<uint8>& Source;
+
+		EBodyEncoding Encoding;
+
+		z_stream Stream;
+
+		bool bInflating = false;
+
+		bool bInputDone = false;
+
+		int32 SourceOffset = 0;
+
+		uint8 Bytes[ChunkSize];
+
+		int32 BytesBegin = 0;
+
+		int32 BytesEnd = 0;
+
+		TCHAR Chars[ChunkSize];
+
+		int32 CharsBegin = 0;
+
+		int32 CharsEnd = 0;
+
+		int64 Position = 0;
+
+		int64 DecodedBytes = 0;
+	};
+}
+
+void FSpotifyTransferStats::Add(const FSpotifyDecodeResult& Result)
+{
+	Responses++;
+	CompressedResponses += Result.bCompressed ? 1 : 0;
+	if(Result.WireBytes >= 0)
+	{
+		BytesOnWire += Result.WireBytes;
+		BytesDecoded += Result.DecodedBytes;
+	}
+	DecodeTimeMs += float(Result.DecodeSeconds * 1000.0);
+}
+
+FSpotifyDecodeResult FSpotifyResponseDecoder::Decode(const FHttpResponsePtr& Response)
+{
+	FSpotifyDecodeResult Result;
+	if(!Response.IsValid()) return Result;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const TArray<uint8>& Body = Response->GetContent();
+	const EBodyEncoding Encoding = DetectEncoding(*Response, Body);
+
+	// The chunk buffers are too large for a worker thread's stack.
+	const TUniquePtr<FDecodingArchive> Archive = MakeUnique<FDecodingArchive>(Body, Encoding);
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Archive.Get());
+	TSharedPtr<FJsonObject> ParsedResponse;
+	if(FJsonSerializer::Deserialize(JsonReader, ParsedResponse) && !Archive->IsError())
+	{
+		Result.Json = ParsedResponse;
+	}
+
+	// Content-Length is the size on the wire even when the HTTP backend inflated the body before handing it over.
+	// Without it (chunked transfer) the body is only the wire size if it is still encoded.
+	const FString ContentEncoding = Response->GetHeader(TEXT("Content-Encoding"));
+	const bool bSentEncoded = !ContentEncoding.IsEmpty() && ContentEncoding != TEXT("identity");
+	int64 ContentLength = -1;
+	if(!LexTryParseString(ContentLength, *Response->GetHeader(TEXT("Content-Length"))) || ContentLength < 0)
+	{
+		ContentLength = bSentEncoded && Encoding == EBodyEncoding::Identity ? -1 : Body.Num();
+	}
+
+	Result.bCompressed = bSentEncoded;
+	Result.WireBytes = ContentLength;
+	Result.DecodedBytes = Archive->GetDecodedBytes();
+	Result.DecodeSeconds = FPlatformTime::Seconds() - StartTime;
+	return Result;
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+#include "SpotifyResponseDecoder.generated.h"
+
+class FJsonObject;
+
+// The numbers of a single decoded response.
+struct FSpotifyDecodeResult
+{
+	TSharedPtr<FJsonObject> Json;
+
+	// Whether the server sent the body content-encoded, regardless of who inflated it.
+	bool bCompressed = false;
+
+	// Size of the body as transferred, -1 if unknown (already inflated by the HTTP backend and no Content-Length).
+	int64 WireBytes = 0;
+
+	// Size of the body once inflated.
+	int64 DecodedBytes = 0;
+
+	double DecodeSeconds = 0.0;
+};
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyTransferStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Responses = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 CompressedResponses = 0;
+
+	// Body bytes as they came over the wire. Responses whose wire size is unknown are left out of both byte counts.
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesOnWire = 0;
+
+	// Body bytes after inflating, what would have been transferred without compression.
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesDecoded = 0;
+
+	// Time spent inflating and parsing on worker threads, in milliseconds.
+	UPROPERTY(BlueprintReadOnly)
+	float DecodeTimeMs = 0.f;
+
+	void Add(const FSpotifyDecodeResult& Result);
+};
+
+/**
+ * Turns a (possibly gzip or deflate encoded) response body into JSON without ever materialising it as a string:
+ * the body is inflated in small chunks, decoded from UTF-8 on the fly and streamed straight into the JSON reader.
+ * Safe to run on any thread.
+ */
+class SPOTIFY_API FSpotifyResponseDecoder
+{
+public:
+
+	// What the API requests ask for.
+	static const TCHAR* AcceptEncoding;
+
+	static FSpotifyDecodeResult Decode(const FHttpResponsePtr& Response);
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyResult.h"
+#include "SpotifyResponseDecoder.h"
+#include "Dom/JsonObject.h"
+
+FSpotifyError FSpotifyError::Make(ESpotifyError Code, const FString& Message)
+{
+	FSpotifyError Error;
+	Error.Code = Code;
+	Error.Message = Message;
+	return Error;
+}
+
+FSpotifyError FSpotifyError::FromResponse(const FHttpResponsePtr& Response, bool bWasSuccessful, ESpotifyEndpoint Endpoint)
+{
+	if(!bWasSuccessful || !Response.IsValid())
+	{
+		return Make(ESpotifyError::ConnectionFailed);
+	}
+
+	FSpotifyError Error;
+	Error.StatusCode = Response->GetResponseCode();
+	if(EHttpResponseCodes::IsOk(Error.StatusCode)) return Error;
+
+	switch(Error.StatusCode)
+	{
+	case 401: Error.Code = ESpotifyError::InvalidAccessKey; break;
+	case 403: Error.Code = ESpotifyError::NonPremium; break;
+	case 404: Error.Code = IsPlayerEndpoint(Endpoint) ? ESpotifyError::NoActiveDevice : ESpotifyError::NotFound; break;
+	case 429:
+		Error.Code = ESpotifyError::RateLimited;
+		// Seconds, missing or garbage still backs off for one.
+		Error.RetryAfterSeconds = FMath::Max(1, FCString::Atoi(*Response->GetHeader(TEXT("Retry-After"))));
+		break;
+	default: Error.Code = Error.StatusCode >= 500 ? ESpotifyError::ServerError : ESpotifyError::Unknown; break;
+	}
+
+	// Error bodies are tiny, decoding them in place is fine: {"error": {"status": 404, "message": "..."}}
+	const FSpotifyDecodeResult Decoded = FSpotifyResponseDecoder::Decode(Response);
+	const TSharedPtr<FJsonObject>* Body;
+	if(Decoded.Json.IsValid() && Decoded.Json->TryGetObjectField("error", Body))
+	{
+		(*Body)->TryGetStringField("message", Error.Message);
+	}
+	return Error;
+}
+
+bool FSpotifyError::IsPlayerEndpoint(ESpotifyEndpoint Endpoint)
+{
+	switch(Endpoint)
+	{
+	case ESpotifyEndpoint::PlaybackState:
+	case ESpotifyEndpoint::Play:
+	case ESpotifyEndpoint::Pause:
+	case ESpotifyEndpoint::Next:
+	case ESpotifyEndpoint::Previous:
+	case ESpotifyEndpoint::Seek:
+	case ESpotifyEndpoint::Volume:
+	case ESpotifyEndpoint::Transfer:
+	case ESpotifyEndpoint::Devices:
+	case ESpotifyEndpoint::Queue:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpotifyRequestTemplate.h"
+#include "Async/Future.h"
+#include "Interfaces/IHttpResponse.h"
+#include "SpotifyResult.generated.h"
+
+UENUM(BlueprintType)
+enum class ESpotifyError : uint8
+{
+	None,
+	// The request never got an answer (no connection, timeout or cancelled).
+	ConnectionFailed,
+	// There is no account with an access key to send the command with (yet).
+	NotAuthorized,
+	// 401, the access key expired or was revoked.
+	InvalidAccessKey,
+	// 403, the command needs a Premium account.
+	NonPremium,
+	// 404 from the player, there is no active device to play on.
+	NoActiveDevice,
+	// 404 from anything but the player (unknown playlist, track...).
+	NotFound,
+	// 429, too many requests.
+	RateLimited,
+	// 5xx
+	ServerError,
+	// The response didn't contain what we expected.
+	InvalidResponse,
+	Unknown
+};
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyError
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	ESpotifyError Code = ESpotifyError::None;
+
+	// HTTP status of the response, 0 if there was none.
+	UPROPERTY(BlueprintReadOnly)
+	int32 StatusCode = 0;
+
+	// The message the Web API sent along, if any.
+	UPROPERTY(BlueprintReadOnly)
+	FString Message;
+
+	// How long the Web API asked to back off for, only set with RateLimited.
+	UPROPERTY(BlueprintReadOnly)
+	int32 RetryAfterSeconds = 0;
+
+	bool IsOk() const { return Code == ESpotifyError::None; }
+
+	static FSpotifyError Make(ESpotifyError Code, const FString& Message = FString());
+
+	// Classifies a finished request to Endpoint, None for any 2xx.
+	static FSpotifyError FromResponse(const FHttpResponsePtr& Response, bool bWasSuccessful, ESpotifyEndpoint Endpoint);
+
+	// Whether Endpoint belongs to the player, where a 404 means there is no active device.
+	static bool IsPlayerEndpoint(ESpotifyEndpoint Endpoint);
+};
+
+// Outcome of an awaitable Spotify call, holds Value if Error is ok.
+template<typename ValueType>
+struct TSpotifyResult
+{
+	ValueType Value;
+
+	FSpotifyError Error;
+
+	bool IsOk() const { return Error.IsOk(); }
+};
+
+// Commands that only succeed or fail.
+template<>
+struct TSpotifyResult<void>
+{
+	FSpotifyError Error;
+
+	bool IsOk() const { return Error.IsOk(); }
+};
+
+/**
+ * Promise of a Spotify call that can't be dropped unfulfilled: if it is destroyed before a value was set
+ * (the request or the service went away in the meantime) whoever waits gets ConnectionFailed.
+ * Share it with the callbacks that may fulfil it, the last one to let go settles it.
+ */
+template<typename ResultType>
+class TSpotifyPromise
+{
+public:
+
+	TSpotifyPromise() = default;
+	TSpotifyPromise(const TSpotifyPromise&) = delete;
+	TSpotifyPromise& operator=(const TSpotifyPromise&) = delete;
+
+	~TSpotifyPromise()
+	{
+		if(!bSet)
+		{
+			ResultType Result;
+			Result.Error = FSpotifyError::Make(ESpotifyError::ConnectionFailed);
+			Promise.SetValue(MoveTemp(Result));
+		}
+	}
+
+	TFuture<ResultType> GetFuture() { return Promise.GetFuture(); }
+
+	void SetValue(ResultType&& Result)
+	{
+		check(!bSet);
+		bSet = true;
+		Promise.SetValue(MoveTemp(Result));
+	}
+
+private:
+
+	TPromise<ResultType> Promise;
+
+	bool bSet = false;
+};
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyDevice
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FString Id;
+
+	UPROPERTY(BlueprintReadOnly)
+	FString Name;
+
+	// Computer, Smartphone, Speaker...
+	UPROPERTY(BlueprintReadOnly)
+	FString Type;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bActive = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 VolumePercent = 0;
+};
@@ -6,37 +6,90 @@
 #include "SHA256.h"
 #include "SpotifyCredentials.h"
 #include "SpotifyDevSettings.h"
+#include "Async/Async.h"
 #include "Common/TcpSocketBuilder.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
 #include "GenericPlatform/GenericPlatformHttp.h"
 #include "Interfaces/IHttpResponse.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Misc/Paths.h"
 
-void USpotifyService::SaveToSlot()
+void USpotifyService::SaveToSlot(const FSpotifyAccount& Account)
 {
 	auto SaveGame = (USpotifyCredentials*)UGameplayStatics::CreateSaveGameObject(USpotifyCredentials::StaticClass());
-	SaveGame->SetValues(Verify, Challenge, RefreshKey);
-	UGameplayStatics::SaveGameToSlot(SaveGame, SaveSlotName, 0);
+	SaveGame->SetValues(Account.Verify, Account.Challenge, Account.RefreshKey);
+	UGameplayStatics::SaveGameToSlot(SaveGame, Account.SaveSlotName, 0);
 }
 
-bool USpotifyService::LoadCredentials()
+bool USpotifyService::LoadCredentials(FSpotifyAccount& Account)
 {
-	if(UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
+	if(UGameplayStatics::DoesSaveGameExist(Account.SaveSlotName, 0))
 	{
-		auto SaveGame = (USpotifyCredentials*)UGameplayStatics::LoadGameFromSlot(SaveSlotName, 0);
+		auto SaveGame = (USpotifyCredentials*)UGameplayStatics::LoadGameFromSlot(Account.SaveSlotName, 0);
 		if(SaveGame && !SaveGame->Verify.IsEmpty() && !SaveGame->Challenge.IsEmpty() && !SaveGame->RefreshKey.IsEmpty())
 		{
-			Verify = SaveGame->Verify;
-			Challenge = SaveGame->Challenge;
-			RefreshKey = SaveGame->RefreshKey;
+			Account.Verify = SaveGame->Verify;
+			Account.Challenge = SaveGame->Challenge;
+			Account.RefreshKey = SaveGame->RefreshKey;
 			return true;
 		}
 	}
 	return false;
 }
 
-void USpotifyService::BeginAuthorization()
+int32 USpotifyService::AddAccount(FName Name, const FString& AccountSaveSlot)
 {
+	const int32 AccountIndex = Accounts.AddDefaulted();
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	Account.Name = Name;
+	Account.SaveSlotName = AccountSaveSlot;
+
+	if(GetDefault<USpotifyDevSettings>()->bRecordListeningHistory)
+	{
+		Account.History.Open(FPaths::ProjectSavedDir() / TEXT("Spotify") / AccountSaveSlot);
+	}
+
+	if(LoadCredentials(Account))
+	{
+		RefreshAccessKey(AccountIndex);
+	}
+	else
+	{
+		PendingAuthorizations.Add(AccountIndex);
+	}
+	return AccountIndex;
+}
+
+void USpotifyService::BeginNextAuthorization()
+{
+	if(AuthorizingAccount != INDEX_NONE || PendingAuthorizations.Num() == 0) return;
+
+	BeginAuthorization(PendingAuthorizations[0]);
+	PendingAuthorizations.RemoveAt(0);
+}
+
+void USpotifyService::FinishAuthorization()
+{
+	AuthorizingAccount = INDEX_NONE;
+	BeginNextAuthorization();
+	if(AuthorizingAccount == INDEX_NONE && ServerSocket)
+	{
+		ServerSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ServerSocket);
+		ServerSocket = nullptr;
+	}
+}
+
+void USpotifyService::BeginAuthorization(int32 AccountIndex)
+{
+	AuthorizingAccount = AccountIndex;
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	UE_LOG(LogSpotify, Log, TEXT("Authorizing Spotify account %s."), *Account.Name.ToString());
+
+	FString& Verify = Account.Verify;
+	FString& Challenge = Account.Challenge;
+	Verify.Reset();
 
 	// Just a bunch of characters.
 	const FString RandomChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
@@ -53,10 +106,13 @@ void USpotifyService::BeginAuthorization()
 		.Replace(TEXT(" "), TEXT(""));
 	Challenge.RemoveFromEnd("=");
 	
-	UKismetSystemLibrary::LaunchURL(FString::Printf(TEXT("https://accounts.spotify.com/authorize?response_type=code&client_id=%s&redirect_uri=%s&scope=user-modify-playback-state,user-read-playback-state,user-read-currently-playing&code_challenge=%s&code_challenge_method=S256"),
-		*ClientKey, *RedirectURL, *Challenge));
+	UKismetSystemLibrary::LaunchURL(FString::Printf(TEXT("%s/authorize?response_type=code&client_id=%s&redirect_uri=%s&scope=user-modify-playback-state,user-read-playback-state,user-read-currently-playing,playlist-read-private,playlist-modify-public,playlist-modify-private&code_challenge=%s&code_challenge_method=S256"),
+		*AccountsBaseUrl, *ClientKey, *RedirectURL, *Challenge));
 	
-	ServerSocket = CreateServerSocket();
+	if(!ServerSocket)
+	{
+		ServerSocket = CreateServerSocket();
+	}
 
 	TSharedRef<FInternetAddr> RemoteAddr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
 }
@@ -141,126 +197,553 @@ void USpotifyService::RetrieveAuthKey(FString HttpResponse)
 	FRegexMatcher ErrorMatcher(ErrorCodeRegex, HttpResponse);
 	if(AuthMatcher.FindNext())
 	{
-		AuthKey = AuthMatcher.GetCaptureGroup(1);
-		bListening = false;
-		ServerSocket->Close();
-		RequestRefreshKey();
+		// A late or repeated redirect after the login finished has no account to go to.
+		if(AuthorizingAccount == INDEX_NONE)
+		{
+			UE_LOG(LogSpotify, Warning, TEXT("Ignoring an authorization code, no account is logging in."));
+		}
+		else
+		{
+			AuthKey = AuthMatcher.GetCaptureGroup(1);
+			bListening = false;
+			RequestRefreshKey(AuthorizingAccount);
+		}
 	}
 	if(ErrorMatcher.FindNext())
 	{
 		UE_LOG(LogSpotify, Error, TEXT("Error Authenticating with Spotify: %s"), *ErrorMatcher.GetCaptureGroup(1));
+		// The user declined (or the login failed), don't hold up the accounts waiting behind this one.
+		if(AuthorizingAccount != INDEX_NONE)
+		{
+			FinishAuthorization();
+		}
 	}
-	
+
 }
 
-void USpotifyService::RefreshAccessKey()
+void USpotifyService::RefreshAccessKey(int32 AccountIndex)
 {
+	const FString& RefreshKey = Accounts[AccountIndex].RefreshKey;
 	if(RefreshKey.IsEmpty() || ClientKey.IsEmpty()) return;
 
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting new Access Key."));
 	
-	auto Request = Http->CreateRequest();
-	Request->SetURL("https://accounts.spotify.com/api/token");
-	Request->SetVerb("POST");
-	Request->SetHeader("Content-Type", "application/x-www-form-urlencoded;charset=UTF-8");
+	auto Request = CreateRequest(ESpotifyEndpoint::Token, nullptr);
 	Request->SetContentAsString(FString::Printf(TEXT("grant_type=refresh_token&refresh_token=%s&client_id=%s"), *RefreshKey, *ClientKey));
-	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveRefreshKey);
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveRefreshKey, AccountIndex);
 	Request->ProcessRequest();
 }
 
-void USpotifyService::RequestRefreshKey()
+void USpotifyService::OnTimerExpired(uint64 Payload)
+{
+	int32 AccountIndex;
+	ESpotifyTimer Timer;
+	FSpotifyAccount::BreakTimerPayload(Payload, AccountIndex, Timer);
+	if(!Accounts.IsValidIndex(AccountIndex)) return;
+
+	switch(Timer)
+	{
+	case ESpotifyTimer::RefreshAccessKey:
+		RefreshAccessKey(AccountIndex);
+		break;
+	case ESpotifyTimer::RequestPlaybackInformation:
+		Accounts[AccountIndex].PlaybackInfoTimer = TimerWheel.Schedule(PollInterval, Payload);
+		RequestPlaybackInformation(AccountIndex);
+		break;
+	case ESpotifyTimer::HedgePlaybackInformation:
+		HedgePlaybackInformation(AccountIndex);
+		break;
+	case ESpotifyTimer::PumpQueue:
+		PumpQueue();
+		break;
+	case ESpotifyTimer::KeepAlive:
+		KeepConnectionsAlive();
+		break;
+	}
+}
+
+const FSpotifyAccount* USpotifyService::GetCommandAccount() const
+{
+	if(!Accounts.IsValidIndex(ActiveAccount) || Accounts[ActiveAccount].AccessKey.IsEmpty()) return nullptr;
+	return &Accounts[ActiveAccount];
+}
+
+FHttpRequestRef USpotifyService::CreateRequest(ESpotifyEndpoint Endpoint, const FSpotifyAccount* Account, FStringView Suffix)
+{
+	ConnectionWarmer.Touch(RequestTemplates.Get(Endpoint).Host, FPlatformTime::Seconds());
+	return RequestTemplates.Create(*Http, Endpoint, Account ? &Account->AuthorizationHeader : nullptr, Suffix);
+}
+
+FHttpRequestRef USpotifyService::CreateRequestForUrl(ESpotifyEndpoint Endpoint, const FSpotifyAccount* Account, const FString& Url)
+{
+	ConnectionWarmer.Touch(RequestTemplates.Get(Endpoint).Host, FPlatformTime::Seconds());
+	return RequestTemplates.CreateForUrl(*Http, Endpoint, Account ? &Account->AuthorizationHeader : nullptr, Url);
+}
+
+void USpotifyService::KeepConnectionsAlive()
+{
+	if(!Http || !ConnectionWarmer.IsEnabled()) return;
+
+	const bool bAnyonePlaying = Accounts.ContainsByPredicate([](const FSpotifyAccount& Account)
+	{
+		return Account.bPlaying && !Account.AccessKey.IsEmpty();
+	});
+	const double NextCheck = ConnectionWarmer.Tick(RequestTemplates, FPlatformTime::Seconds(), bAnyonePlaying, [this](const FString& Url)
+	{
+		FSpotifyConnectionWarmer::Ping(*Http, Url);
+	});
+	KeepAliveTimer = TimerWheel.Schedule(NextCheck, FSpotifyAccount::MakeTimerPayload(0, ESpotifyTimer::KeepAlive));
+}
+
+void USpotifyService::RequestRefreshKey(int32 AccountIndex)
 {
 	if(!Http) return;
 
-	auto Request = Http->CreateRequest();
-	Request->SetURL("https://accounts.spotify.com/api/token");
-	Request->SetVerb("POST");
+	auto Request = CreateRequest(ESpotifyEndpoint::Token, nullptr);
 	const FString Body = FString::Printf(TEXT("grant_type=authorization_code&code=%s&redirect_uri=%s&client_id=%s&code_verifier=%s"),
-		*AuthKey, *RedirectURL, *ClientKey, *Verify);
+		*AuthKey, *RedirectURL, *ClientKey, *Accounts[AccountIndex].Verify);
 	Request->SetContentAsString(Body);
-	Request->SetHeader("Content-Type", "application/x-www-form-urlencoded;charset=UTF-8");
-	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveRefreshKey);
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveRefreshKey, AccountIndex);
 	Request->ProcessRequest();
 }
 
-void USpotifyService::RequestPlaybackInformation()
+void USpotifyService::RequestPlaybackInformation(int32 AccountIndex)
 {
-	if(!Http || AccessKey.IsEmpty()) return;
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	if(!Http || Account.AccessKey.IsEmpty()) return;
 
-	auto Request = Http->CreateRequest();
-	Request->SetURL("https://api.spotify.com/v1/me/player?market=from_token");
-	Request->SetVerb("GET");
-	Request->SetHeader("Authorization", FString::Printf(TEXT("Bearer %s"), *AccessKey));
-	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlaybackInformation);
-	Request->ProcessRequest();
+	// Still waiting on the last poll (or its hedge), piling up more requests won't get an answer sooner.
+	if(Account.PlaybackRequest.IsValid() || Account.PlaybackHedge.IsValid())
+	{
+		if(FPlatformTime::Seconds() - Account.PlaybackRequestTime < StalePollTimeout) return;
+
+		// Stuck for good, start over.
+		TimerWheel.Cancel(Account.HedgeTimer);
+		const FHttpRequestPtr StaleRequest = Account.PlaybackRequest;
+		const FHttpRequestPtr StaleHedge = Account.PlaybackHedge;
+		Account.PlaybackRequest.Reset();
+		Account.PlaybackHedge.Reset();
+		if(StaleRequest.IsValid()) StaleRequest->CancelRequest();
+		if(StaleHedge.IsValid()) StaleHedge->CancelRequest();
+	}
+
+	Account.PlaybackRequest = SendPlaybackInformationRequest(AccountIndex);
+	Account.PlaybackRequestTime = FPlatformTime::Seconds();
+
+	const double HedgeDelay = PlaybackHedging.OnRequestSent();
+	if(HedgeDelay >= 0.0)
+	{
+		Account.HedgeTimer = TimerWheel.Schedule(HedgeDelay,
+			FSpotifyAccount::MakeTimerPayload(AccountIndex, ESpotifyTimer::HedgePlaybackInformation));
+	}
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Playback Info."));
 }
 
-void USpotifyService::PlaybackRequest(const FString& Url, const FString& Verb)
+FHttpRequestPtr USpotifyService::SendPlaybackInformationRequest(int32 AccountIndex)
 {
-	if(!Http || AccessKey.IsEmpty()) return;
-	
-	auto Request = Http->CreateRequest();
-	Request->SetURL(Url);
-	Request->SetVerb(Verb);
-	Request->SetHeader("Authorization", FString::Printf(TEXT("Bearer %s"), *AccessKey));
-	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlay);
+	auto Request = CreateRequest(ESpotifyEndpoint::PlaybackState, &Accounts[AccountIndex]);
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlaybackInformation, AccountIndex);
 	Request->ProcessRequest();
+	return Request;
+}
+
+void USpotifyService::HedgePlaybackInformation(int32 AccountIndex)
+{
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	if(!Account.PlaybackRequest.IsValid() || Account.PlaybackHedge.IsValid() || !PlaybackHedging.TryHedge()) return;
+
+	Account.PlaybackHedge = SendPlaybackInformationRequest(AccountIndex);
+	UE_LOG(LogSpotify, Verbose, TEXT("Hedging Playback Info."));
 }
 
-void USpotifyService::PlaybackRequest(const FString& Url, const FString& Verb, const FString& Body)
+TFuture<TSpotifyResult<void>> USpotifyService::PlaybackRequest(ESpotifyEndpoint Endpoint, FStringView Suffix, const FString& Body)
 {
-	if(!Http || AccessKey.IsEmpty()) return;
+	const FSpotifyAccount* Account = GetCommandAccount();
+	if(!Http || !Account)
+	{
+		return MakeFulfilledPromise<TSpotifyResult<void>>(TSpotifyResult<void>{FSpotifyError::Make(ESpotifyError::NotAuthorized)}).GetFuture();
+	}
 	
-	auto Request = Http->CreateRequest();
-	Request->SetURL(Url);
-	Request->SetVerb(Verb);
-	Request->SetHeader("Authorization", FString::Printf(TEXT("Bearer %s"), *AccessKey));
-	Request->SetContentAsString(Body);
-	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlay);
+	auto Request = CreateRequest(Endpoint, Account, Suffix);
+	if(!Body.IsEmpty())
+	{
+		Request->SetContentAsString(Body);
+	}
+
+	// Not bound to the service: the promise has to be fulfilled even if the service went away in the meantime.
+	const TSharedRef<TSpotifyPromise<TSpotifyResult<void>>> Promise = MakeShared<TSpotifyPromise<TSpotifyResult<void>>>();
+	Request->OnProcessRequestComplete().BindLambda([Promise, Endpoint](FHttpRequestPtr, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		Promise->SetValue(TSpotifyResult<void>{OnError(Response, bWasSuccessful, Endpoint)});
+	});
 	Request->ProcessRequest();
+	return Promise->GetFuture();
 }
 
-void USpotifyService::RequestPlay()
+TFuture<TSpotifyResult<void>> USpotifyService::Play()
 {
-	PlaybackRequest("https://api.spotify.com/v1/me/player/play", "PUT");
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Resume Playback."));
+	return PlaybackRequest(ESpotifyEndpoint::Play);
 }
 
-void USpotifyService::RequestPause()
+TFuture<TSpotifyResult<void>> USpotifyService::Pause()
 {
-	PlaybackRequest("https://api.spotify.com/v1/me/player/pause", "PUT");
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Pause Playback."));
+	return PlaybackRequest(ESpotifyEndpoint::Pause);
 }
 
-void USpotifyService::RequestNext()
+TFuture<TSpotifyResult<void>> USpotifyService::SkipToNext()
 {
-	PlaybackRequest("https://api.spotify.com/v1/me/player/next", "POST");
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Next Song."));
+	return PlaybackRequest(ESpotifyEndpoint::Next);
 }
 
-void USpotifyService::RequestPrev()
+TFuture<TSpotifyResult<void>> USpotifyService::SkipToPrevious()
 {
-	PlaybackRequest("https://api.spotify.com/v1/me/player/previous", "POST");
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Previous Song."));
+	return PlaybackRequest(ESpotifyEndpoint::Previous);
 }
 
-void USpotifyService::Seek(int TimeInSeconds)
+TFuture<TSpotifyResult<void>> USpotifyService::SeekTo(int32 PositionMs)
 {
-	const int TimeInMS = TimeInSeconds * 1000;
-	PlaybackRequest("https://api.spotify.com/v1/me/player/previous", "PUT", FString::Printf(TEXT("position_ms=%d"), TimeInMS));
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Seek."));
+	return PlaybackRequest(ESpotifyEndpoint::Seek, LexToString(FMath::Max(0, PositionMs)));
 }
 
-void USpotifyService::SetVolume(float Val)
+TFuture<TSpotifyResult<void>> USpotifyService::SetVolumePercent(int32 VolumePercent)
 {
-	const int VolPercent = FMath::Clamp<float>(Val * 100, 0, 100);
-	PlaybackRequest(FString::Printf(TEXT("https://api.spotify.com/v1/me/player/volume?volume_percent=%d"), VolPercent), "PUT");
 	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Volume."));
+	return PlaybackRequest(ESpotifyEndpoint::Volume, LexToString(FMath::Clamp(VolumePercent, 0, 100)));
+}
+
+TFuture<TSpotifyResult<void>> USpotifyService::TransferPlayback(const FString& DeviceId, bool bPlay)
+{
+	FString Body;
+	const auto Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Body);
+	Writer->WriteObjectStart();
+	Writer->WriteArrayStart(TEXT("device_ids"));
+	Writer->WriteValue(DeviceId);
+	Writer->WriteArrayEnd();
+	Writer->WriteValue(TEXT("play"), bPlay);
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Playback Transfer."));
+	return PlaybackRequest(ESpotifyEndpoint::Transfer, FStringView(), Body);
+}
+
+TFuture<TSpotifyResult<TArray<FSpotifyDevice>>> USpotifyService::GetDevices()
+{
+	using FResult = TSpotifyResult<TArray<FSpotifyDevice>>;
+	const FSpotifyAccount* Account = GetCommandAccount();
+	if(!Http || !Account)
+	{
+		return MakeFulfilledPromise<FResult>(FResult{{}, FSpotifyError::Make(ESpotifyError::NotAuthorized)}).GetFuture();
+	}
+
+	auto Request = CreateRequest(ESpotifyEndpoint::Devices, Account);
+
+	// Dropped unset (e.g. the service went away while decoding) it still answers with ConnectionFailed.
+	const TSharedRef<TSpotifyPromise<FResult>> Promise = MakeShared<TSpotifyPromise<FResult>>();
+	Request->OnProcessRequestComplete().BindLambda([WeakThis = TWeakObjectPtr<USpotifyService>(this), Promise](FHttpRequestPtr, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		const FSpotifyError Error = OnError(Response, bWasSuccessful, ESpotifyEndpoint::Devices);
+		USpotifyService* This = WeakThis.Get();
+		if(!Error.IsOk() || !This)
+		{
+			Promise->SetValue(FResult{{}, Error.IsOk() ? FSpotifyError::Make(ESpotifyError::ConnectionFailed) : Error});
+			return;
+		}
+		This->DecodeResponseAsync(Response, [Promise](TSharedPtr<FJsonObject> ParsedResponse)
+		{
+			FResult Result;
+			const TArray<TSharedPtr<FJsonValue>>* Devices;
+			if(!ParsedResponse.IsValid() || !ParsedResponse->TryGetArrayField("devices", Devices))
+			{
+				Result.Error = FSpotifyError::Make(ESpotifyError::InvalidResponse);
+				Promise->SetValue(MoveTemp(Result));
+				return;
+			}
+			for(const auto& Value : *Devices)
+			{
+				const TSharedPtr<FJsonObject> Device = Value->AsObject();
+				FSpotifyDevice& Entry = Result.Value.AddDefaulted_GetRef();
+				// Restricted devices come without an id.
+				Device->TryGetStringField("id", Entry.Id);
+				Entry.Name = Device->GetStringField("name");
+				Entry.Type = Device->GetStringField("type");
+				Entry.bActive = Device->GetBoolField("is_active");
+				Device->TryGetNumberField("volume_percent", Entry.VolumePercent);
+			}
+			Promise->SetValue(MoveTemp(Result));
+		});
+	});
+	Request->ProcessRequest();
+	return Promise->GetFuture();
+}
+
+TFuture<TSpotifyResult<void>> USpotifyService::StartPlayback(const FSpotifyPlayRequest& PlayRequest)
+{
+	FString Body;
+	const auto Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Body);
+	Writer->WriteObjectStart();
+	if(!PlayRequest.ContextUri.IsEmpty())
+	{
+		Writer->WriteValue(TEXT("context_uri"), PlayRequest.ContextUri);
+	}
+	else if(PlayRequest.Uris.Num() > 0)
+	{
+		Writer->WriteValue(TEXT("uris"), PlayRequest.Uris);
+	}
+	if(!PlayRequest.OffsetUri.IsEmpty())
+	{
+		Writer->WriteObjectStart(TEXT("offset"));
+		Writer->WriteValue(TEXT("uri"), PlayRequest.OffsetUri);
+		Writer->WriteObjectEnd();
+	}
+	else if(PlayRequest.OffsetPosition >= 0)
+	{
+		Writer->WriteObjectStart(TEXT("offset"));
+		Writer->WriteValue(TEXT("position"), PlayRequest.OffsetPosition);
+		Writer->WriteObjectEnd();
+	}
+	if(PlayRequest.PositionMs > 0)
+	{
+		Writer->WriteValue(TEXT("position_ms"), PlayRequest.PositionMs);
+	}
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Start Playback."));
+	return PlaybackRequest(ESpotifyEndpoint::Play, FStringView(), Body);
+}
+
+TFuture<TSpotifyResult<void>> USpotifyService::Enqueue(const TArray<FString>& Uris, TFunction<void(int32 Index, const FSpotifyError& Error)> OnItemCompleted)
+{
+	if(!Http || !GetCommandAccount())
+	{
+		return MakeFulfilledPromise<TSpotifyResult<void>>(TSpotifyResult<void>{FSpotifyError::Make(ESpotifyError::NotAuthorized)}).GetFuture();
+	}
+	if(Uris.Num() == 0)
+	{
+		return MakeFulfilledPromise<TSpotifyResult<void>>().GetFuture();
+	}
+
+	const TSharedPtr<FSpotifyQueueBatch> Batch = MakeShared<FSpotifyQueueBatch>();
+	Batch->Account = ActiveAccount;
+	Batch->Uris = Uris;
+	Batch->Attempts.SetNumZeroed(Uris.Num());
+	Batch->Results.SetNum(Uris.Num());
+	Batch->OnItemCompleted = MoveTemp(OnItemCompleted);
+	TFuture<TSpotifyResult<void>> Future = Batch->Promise.GetFuture();
+
+	QueueBatches.Add(Batch);
+	PumpQueue();
+	UE_LOG(LogSpotify, Verbose, TEXT("Enqueueing %d Tracks."), Uris.Num());
+	return Future;
 }
 
-void USpotifyService::ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+void USpotifyService::PumpQueue()
 {
+	TimerWheel.Cancel(QueuePumpTimer);
+	while(QueueBatches.Num() > 0 && QueueInFlight < QueueWindow)
+	{
+		const TSharedPtr<FSpotifyQueueBatch> Batch = QueueBatches[0];
+		// Everything is sent, the rest only waits for answers.
+		if(Batch->IsSent()) return;
+
+		const double Now = FPlatformTime::Seconds();
+		if(!QueueRateLimiter.TryAcquire(Now))
+		{
+			QueuePumpTimer = TimerWheel.Schedule(QueueRateLimiter.GetWaitSeconds(Now),
+				FSpotifyAccount::MakeTimerPayload(Batch->Account, ESpotifyTimer::PumpQueue));
+			return;
+		}
+
+		int32 Index;
+		if(Batch->Retries.Num() > 0)
+		{
+			Index = Batch->Retries[0];
+			Batch->Retries.RemoveAt(0);
+		}
+		else
+		{
+			Index = Batch->NextToSend++;
+		}
+		SendQueueItem(Batch, Index);
+	}
+}
+
+void USpotifyService::SendQueueItem(TSharedPtr<FSpotifyQueueBatch> Batch, int32 Index)
+{
+	Batch->Attempts[Index]++;
+	QueueInFlight++;
+
+	auto Request = CreateRequest(ESpotifyEndpoint::Queue, &Accounts[Batch->Account], FGenericPlatformHttp::UrlEncode(Batch->Uris[Index]));
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveQueueItem, Batch, Index);
+	Request->ProcessRequest();
+}
+
+void USpotifyService::RequestPlay()
+{
+	Play();
+}
+
+void USpotifyService::RequestPause()
+{
+	Pause();
+}
+
+void USpotifyService::RequestNext()
+{
+	SkipToNext();
+}
+
+void USpotifyService::RequestPrev()
+{
+	SkipToPrevious();
+}
+
+void USpotifyService::Seek(int TimeInSeconds)
+{
+	SeekTo(TimeInSeconds * 1000);
+}
+
+void USpotifyService::SetVolume(float Val)
+{
+	SetVolumePercent(FMath::RoundToInt(FMath::Clamp(Val, 0.f, 1.f) * 100.f));
+}
+
+void USpotifyService::RequestAudioAnalysis(const FString& TrackId)
+{
+	const FSpotifyAccount* Account = GetCommandAccount();
+	if(!Http || !Account || TrackId.IsEmpty()) return;
+
+	bool bAlreadyPending = false;
+	PendingAnalyses.Add(TrackId, &bAlreadyPending);
+	if(bAlreadyPending) return;
+
+	auto Request = CreateRequest(ESpotifyEndpoint::AudioAnalysis, Account, TrackId);
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceiveAudioAnalysis, TrackId);
+	Request->ProcessRequest();
+	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Audio Analysis."));
+}
+
+void USpotifyService::SyncPlaylist(const FString& PlaylistId, const TArray<FString>& TrackUris)
+{
+	if(!Http || !GetCommandAccount()) return;
+
+	if(PlaylistSyncs.Contains(PlaylistId))
+	{
+		UE_LOG(LogSpotify, Warning, TEXT("Playlist %s is already being synchronised."), *PlaylistId);
+		return;
+	}
+
+	const TSharedPtr<FSpotifyPlaylistSync> Sync = MakeShared<FSpotifyPlaylistSync>();
+	Sync->PlaylistId = PlaylistId;
+	Sync->Account = ActiveAccount;
+	Sync->Target = TrackUris;
+	PlaylistSyncs.Add(PlaylistId, Sync);
+
+	RequestPlaylistPage(Sync, CreateRequest(ESpotifyEndpoint::Playlist, &Accounts[Sync->Account], PlaylistId + TEXT("?fields=snapshot_id,tracks(items(track(uri)),next)")));
+	UE_LOG(LogSpotify, Verbose, TEXT("Requesting Playlist Sync."));
+}
+
+void USpotifyService::RequestPlaylistPage(TSharedPtr<FSpotifyPlaylistSync> Sync, const FHttpRequestRef& Request)
+{
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlaylistPage, Sync);
+	Request->ProcessRequest();
+}
+
+void USpotifyService::RequestPlaylistMutation(TSharedPtr<FSpotifyPlaylistSync> Sync)
+{
+	if(!Sync->Mutations.IsValidIndex(Sync->NextMutation))
+	{
+		FinishPlaylistSync(Sync, true);
+		return;
+	}
+	const FSpotifyPlaylistMutation& Mutation = Sync->Mutations[Sync->NextMutation];
+
+	FString Body;
+	const auto Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Body);
+	Writer->WriteObjectStart();
+	// Reorder and Replace are a PUT.
+	ESpotifyEndpoint Endpoint = ESpotifyEndpoint::PlaylistUpdate;
+	switch(Mutation.Op)
+	{
+	case ESpotifyPlaylistOp::Remove:
+		Endpoint = ESpotifyEndpoint::PlaylistRemove;
+		Writer->WriteArrayStart(TEXT("tracks"));
+		for(int32 i = 0; i < Mutation.Uris.Num(); i++)
+		{
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("uri"), Mutation.Uris[i]);
+			Writer->WriteArrayStart(TEXT("positions"));
+			Writer->WriteValue(Mutation.Positions[i]);
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteValue(TEXT("snapshot_id"), Sync->SnapshotId);
+		break;
+	case ESpotifyPlaylistOp::Reorder:
+		Writer->WriteValue(TEXT("range_start"), Mutation.RangeStart);
+		Writer->WriteValue(TEXT("insert_before"), Mutation.InsertBefore);
+		Writer->WriteValue(TEXT("range_length"), Mutation.RangeLength);
+		Writer->WriteValue(TEXT("snapshot_id"), Sync->SnapshotId);
+		break;
+	case ESpotifyPlaylistOp::Add:
+		Endpoint = ESpotifyEndpoint::PlaylistAdd;
+		Writer->WriteValue(TEXT("uris"), Mutation.Uris);
+		Writer->WriteValue(TEXT("position"), Mutation.Position);
+		break;
+	case ESpotifyPlaylistOp::Replace:
+		Writer->WriteValue(TEXT("uris"), Mutation.Uris);
+		break;
+	}
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	auto Request = CreateRequest(Endpoint, &Accounts[Sync->Account], Sync->PlaylistId + TEXT("/tracks"));
+	Request->SetContentAsString(Body);
+	Request->OnProcessRequestComplete().BindUObject(this, &USpotifyService::ReceivePlaylistMutation, Sync);
+	Request->ProcessRequest();
+}
+
+void USpotifyService::FinishPlaylistSync(TSharedPtr<FSpotifyPlaylistSync> Sync, bool bSuccess)
+{
+	PlaylistSyncs.Remove(Sync->PlaylistId);
+	WorkQueue.Enqueue(ESpotifyWorkPriority::Normal, [this, PlaylistId = Sync->PlaylistId, bSuccess]()
+	{
+		OnPlaylistSyncedDelegate.Broadcast(PlaylistId, bSuccess);
+	});
+	UE_LOG(LogSpotify, Verbose, TEXT("Playlist %s synchronised with %d requests."), *Sync->PlaylistId, Sync->NextMutation);
+}
+
+void USpotifyService::DecodeResponseAsync(FHttpResponsePtr Response, TFunction<void(TSharedPtr<FJsonObject>)> OnDecoded)
+{
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<USpotifyService>(this), Response, OnDecoded = MoveTemp(OnDecoded)]() mutable
+	{
+		FSpotifyDecodeResult Result = FSpotifyResponseDecoder::Decode(Response);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Result = MoveTemp(Result), OnDecoded = MoveTemp(OnDecoded)]()
+		{
+			if(USpotifyService* This = WeakThis.Get())
+			{
+				This->TransferStats.Add(Result);
+				OnDecoded(Result.Json);
+			}
+		});
+	});
+}
+
+void USpotifyService::ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful,
+	int32 AccountIndex)
+{
+	if(!Accounts.IsValidIndex(AccountIndex)) return;
+	if(AccountIndex == AuthorizingAccount)
+	{
+		FinishAuthorization();
+	}
 	if(!bWasSuccessful) return;
 
 	if( Response->GetResponseCode() >= 200 && Response->GetResponseCode() < 300)
@@ -270,15 +753,19 @@ void USpotifyService::ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePt
 		TSharedPtr<FJsonObject> ParsedResponse;
 		if(FJsonSerializer::Deserialize(JsonReader, ParsedResponse))
 		{
+			FSpotifyAccount& Account = Accounts[AccountIndex];
 			const int Expires = ParsedResponse->GetIntegerField("expires_in");
-			AccessKeyExpiration = FDateTime::Now() + FTimespan(0, 0, Expires);
-			AccessKey = ParsedResponse->GetStringField("access_token");
-			RefreshKey = ParsedResponse->GetStringField("refresh_token");
+			Account.AccessKeyExpiration = FDateTime::Now() + FTimespan(0, 0, Expires);
+			Account.SetAccessKey(ParsedResponse->GetStringField("access_token"));
+			Account.RefreshKey = ParsedResponse->GetStringField("refresh_token");
 			// Resfresh Access Key 50 Seconds before it expires.
-			GetWorld()->GetTimerManager().ClearTimer(AccessKeyExpireTimerHandle);
-			GetWorld()->GetTimerManager().ClearTimer(PlaybackInfoTimerHandle);
-			GetWorld()->GetTimerManager().SetTimer(AccessKeyExpireTimerHandle, this, &USpotifyService::RefreshAccessKey, Expires - 50, false);
-			GetWorld()->GetTimerManager().SetTimer(PlaybackInfoTimerHandle, this, &USpotifyService::RequestPlaybackInformation, 1, true);
+			TimerWheel.Cancel(Account.RefreshTimer);
+			TimerWheel.Cancel(Account.PlaybackInfoTimer);
+			Account.RefreshTimer = TimerWheel.Schedule(Expires - 50,
+				FSpotifyAccount::MakeTimerPayload(AccountIndex, ESpotifyTimer::RefreshAccessKey));
+			// Spread the polls of all accounts over the interval instead of sending them in one burst.
+			Account.PlaybackInfoTimer = TimerWheel.Schedule(PollInterval * (1.f + float(AccountIndex) / Accounts.Num()),
+				FSpotifyAccount::MakeTimerPayload(AccountIndex, ESpotifyTimer::RequestPlaybackInformation));
 		}
 		
 		return;
@@ -288,82 +775,632 @@ void USpotifyService::ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePt
 
 
 void USpotifyService::ReceivePlaybackInformation(FHttpRequestPtr Request, FHttpResponsePtr Response,
-	bool bWasSuccessful)
+	bool bWasSuccessful, int32 AccountIndex)
 {
-	if(!bWasSuccessful) return;
+	if(!Accounts.IsValidIndex(AccountIndex)) return;
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+
+	// Anything but the poll or its hedge lost the race (or was cancelled because of it).
+	const bool bHedge = Request == Account.PlaybackHedge;
+	if(!bHedge && Request != Account.PlaybackRequest) return;
+
+	if(!bWasSuccessful)
+	{
+		// The other one may still answer.
+		(bHedge ? Account.PlaybackHedge : Account.PlaybackRequest).Reset();
+		return;
+	}
+
+	// Recorded before the loser is cancelled, a losing first request counts with how long it ran (see FSpotifyHedgePolicy).
+	PlaybackHedging.OnCompleted(FPlatformTime::Seconds() - Account.PlaybackRequestTime, bHedge);
+
+	// First answer wins, the other one is cancelled.
+	TimerWheel.Cancel(Account.HedgeTimer);
+	const FHttpRequestPtr Loser = bHedge ? Account.PlaybackRequest : Account.PlaybackHedge;
+	Account.PlaybackRequest.Reset();
+	Account.PlaybackHedge.Reset();
+	if(Loser.IsValid())
+	{
+		Loser->CancelRequest();
+	}
+
 	if(Response->GetResponseCode() == 200)
 	{
-		const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Response->GetContentAsString());
-		TSharedPtr<FJsonObject> ParsedResponse;
-		if(FJsonSerializer::Deserialize(JsonReader, ParsedResponse))
+		DecodeResponseAsync(Response, [this, AccountIndex](TSharedPtr<FJsonObject> ParsedResponse)
+		{
+			if(ParsedResponse.IsValid() && Accounts.IsValidIndex(AccountIndex))
+			{
+				ApplyPlaybackInformation(AccountIndex, *ParsedResponse);
+			}
+		});
+	}
+	if(Response->GetResponseCode() == 204)
+	{
+		const bool bWasPlaying = Account.bPlaying;
+		Account.bPlaying = false;
+		if(bWasPlaying && AccountIndex == ActiveAccount)
+		{
+			BroadcastPlaybackChanged(ESpotifyPlaybackFields::PlayState);
+		}
+		if(Account.ListeningSpanStart != 0)
+		{
+			CloseListeningSpan(AccountIndex, FSpotifyListeningHistory::NowUnixMs());
+		}
+		UE_LOG(LogSpotify, Verbose, TEXT("Received Playback, no device playing or in private session."));
+	}
+}
+
+void USpotifyService::ApplyPlaybackInformation(int32 AccountIndex, const FJsonObject& ParsedResponse)
+{
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	const bool bActive = AccountIndex == ActiveAccount;
+
+	// Every poll runs through here: the field names are built once and the id is read into a reused buffer,
+	// so an unchanged song doesn't allocate (see Spotify.NamePool.PollAllocations).
+	static const FString ProgressField(TEXT("progress_ms"));
+	static const FString PlayingField(TEXT("is_playing"));
+	static const FString DeviceField(TEXT("device"));
+	static const FString ItemField(TEXT("item"));
+	static const FString VolumeField(TEXT("volume_percent"));
+	static const FString DurationField(TEXT("duration_ms"));
+	static const FString IdField(TEXT("id"));
+
+	const int Progress = ParsedResponse.GetIntegerField(ProgressField);
+	const bool Playing = ParsedResponse.GetBoolField(PlayingField);
+
+	const TSharedPtr<FJsonObject>& Device = ParsedResponse.GetObjectField(DeviceField);
+	const TSharedPtr<FJsonObject>& Item = ParsedResponse.GetObjectField(ItemField);
+
+	const int Volume = Device->GetIntegerField(VolumeField);
+	const int Duration = Item->GetIntegerField(DurationField);
+
+	// Local files have no id.
+	if(!Item->TryGetStringField(IdField, PolledSongId))
+	{
+		PolledSongId.Reset();
+	}
+	const FString& SongId = PolledSongId;
+	const bool bSongChanged = NamePool.Get(Account.SongId) != SongId;
+
+	// A play span ends with a pause or a track change, a track counts as skipped if it was left well before its end.
+	const int64 NowMs = FSpotifyListeningHistory::NowUnixMs();
+	if(Account.ListeningSpanStart != 0 && (!Playing || bSongChanged))
+	{
+		CloseListeningSpan(AccountIndex, NowMs);
+	}
+	if(Playing)
+	{
+		Account.ListeningSpanStart = Account.ListeningSpanStart != 0 ? Account.ListeningSpanStart : NowMs;
+		Account.ListeningSeenAt = NowMs;
+	}
+	const int SkipToleranceMs = FMath::Max(10000, FMath::CeilToInt(PollInterval * 3000.f));
+	const bool bPreviousSkipped = Account.SongId.IsValid() && Account.PlaybackProgress + SkipToleranceMs < Account.PlaybackDuration;
+
+	ESpotifyPlaybackFields Changed = ESpotifyPlaybackFields::None;
+	if(Playing != Account.bPlaying) Changed |= ESpotifyPlaybackFields::PlayState;
+	if(Duration != Account.PlaybackDuration) Changed |= ESpotifyPlaybackFields::Duration;
+	if(!Playing && Progress != Account.PlaybackProgress) Changed |= ESpotifyPlaybackFields::Position;
+
+	Account.PlaybackProgress = Progress;
+	Account.PlaybackDuration = Duration;
+	Account.PlaybackSyncTime = FPlatformTime::Seconds();
+	Account.bPlaying = Playing;
+
+	// Same song as last poll: a single compare against the interned id, no names are built.
+	if(!bSongChanged && !Account.bNeedsFullUpdate)
+	{
+		if(bActive)
+		{
+			bPlaybackAdvancePending = true;
+			PendingPlaybackFields |= Changed;
+			PostPlaybackNotification();
+		}
+		return;
+	}
+	const TArray<TSharedPtr<FJsonValue>>& Artists = Item->GetArrayField("artists");
+	const TSharedPtr<FJsonObject> Album = Item->GetObjectField("album");
+	Account.bNeedsFullUpdate = false;
+	Changed |= ESpotifyPlaybackFields::Position;
+	NamePool.Assign(Account.SongId, SongId);
+	if(NamePool.Assign(Account.SongName, Item->GetStringField("name"))) Changed |= ESpotifyPlaybackFields::SongName;
+	if(NamePool.Assign(Account.AlbumName, Album->GetStringField("name"))) Changed |= ESpotifyPlaybackFields::AlbumName;
+
+	// Covers are listed widest first, take the smallest one that still is 300px wide.
+	FString ImageUrl;
+	int32 ImageWidth = 0;
+	const TArray<TSharedPtr<FJsonValue>>* Images;
+	if(Album->TryGetArrayField("images", Images))
+	{
+		for(const TSharedPtr<FJsonValue>& Image : *Images)
 		{
-			
-			const int Progress = ParsedResponse->GetIntegerField("progress_ms");
-			const bool Playing = ParsedResponse->GetBoolField("is_playing");
-			
-
-			const TSharedPtr<FJsonObject> Device = ParsedResponse->GetObjectField("device");
-			const TSharedPtr<FJsonObject> Item = ParsedResponse->GetObjectField("item");
-			const TArray<TSharedPtr<FJsonValue>> Artists = Item->GetArrayField("artists");
-			const TSharedPtr<FJsonObject> Album = Item->GetObjectField("album");
-
-			const int Volume = Device->GetIntegerField("volume_percent");
-			const int Duration = Item->GetIntegerField("duration_ms");
-			const FString SongName = Item->GetStringField("name");
-			const FString AlbumName = Album->GetStringField("name");
-			TArray<FString> ArtistNames;
-			for(const auto& Artist : Artists)
+			const TSharedPtr<FJsonObject>* ImageObject;
+			if(!Image->TryGetObject(ImageObject)) continue;
+			// Local files and some podcasts list images without a size.
+			int32 Width = 0;
+			(*ImageObject)->TryGetNumberField("width", Width);
+			if(ImageUrl.IsEmpty() || (Width >= 300 && Width < ImageWidth))
 			{
-				ArtistNames.Add( Artist->AsObject()->GetStringField("name"));
+				ImageUrl = (*ImageObject)->GetStringField("url");
+				ImageWidth = Width;
 			}
+		}
+	}
+	if(NamePool.Assign(Account.AlbumImageUrl, ImageUrl)) Changed |= ESpotifyPlaybackFields::AlbumImage;
 
-			if(SongId == Item->GetStringField("id"))
+	// Intern the new artists before releasing the old ones, so shared artists keep their entry.
+	TArray<FSpotifyNameHandle, TInlineAllocator<4>> NewArtists;
+	for(const auto& Artist : Artists)
+	{
+		NewArtists.Add(NamePool.Intern(Artist->AsObject()->GetStringField("name")));
+	}
+	if(NewArtists != Account.Artists) Changed |= ESpotifyPlaybackFields::Artists;
+	for(FSpotifyNameHandle& Artist : Account.Artists)
+	{
+		NamePool.Release(Artist);
+	}
+	Account.Artists = MoveTemp(NewArtists);
+
+	const FString& SongName = NamePool.Get(Account.SongName);
+	if(bSongChanged && Account.History.IsOpen())
+	{
+		WorkQueue.Enqueue(ESpotifyWorkPriority::Background, [this, AccountIndex, NowMs, SongId, SongName,
+			Artist = Account.Artists.Num() > 0 ? NamePool.Get(Account.Artists[0]) : FString(), bPreviousSkipped]()
+		{
+			if(Accounts.IsValidIndex(AccountIndex))
 			{
-				OnPlaybackAdvancedDelegate.Broadcast(Duration, Progress);
-				return;
+				Accounts[AccountIndex].History.RecordTrack(NowMs, SongId, SongName, Artist, bPreviousSkipped);
 			}
-			SongId = Item->GetStringField("id");
-			OnReceivePlaybackDataDelegate.Broadcast(SongName, ArtistNames, AlbumName, Volume, Duration, Progress, Playing);
-			
+		});
+	}
+	if(bSongChanged)
+	{
+		WorkQueue.Enqueue(ESpotifyWorkPriority::Normal, [this, AccountName = Account.Name, SongName, Playing]()
+		{
+			OnAccountSongChangedDelegate.Broadcast(AccountName, SongName, Playing);
+		});
+	}
+	if(!bActive) return;
+
+	// Local files and episodes have no id and no analysis.
+	const TSharedPtr<const FSpotifyAudioAnalysis>* Analysis = SongId.IsEmpty() ? nullptr : AnalysisCache.Find(SongId);
+	BeatCursor.Reset(Analysis ? *Analysis : nullptr);
+	if(!Analysis && !SongId.IsEmpty())
+	{
+		RequestAudioAnalysis(SongId);
+	}
+
+	TArray<FString> ArtistNames;
+	for(const FSpotifyNameHandle& Artist : Account.Artists)
+	{
+		ArtistNames.Add(NamePool.Get(Artist));
+	}
+	WorkQueue.Enqueue(ESpotifyWorkPriority::UserVisible, [this, SongName, ArtistNames = MoveTemp(ArtistNames),
+		AlbumName = NamePool.Get(Account.AlbumName), Volume, Duration, Progress, Playing]()
+	{
+		OnReceivePlaybackDataDelegate.Broadcast(SongName, ArtistNames, AlbumName, Volume, Duration, Progress, Playing);
+	});
+	BroadcastPlaybackChanged(Changed);
+}
+
+void USpotifyService::BroadcastPlaybackChanged(ESpotifyPlaybackFields Fields)
+{
+	PendingPlaybackFields |= Fields;
+	PostPlaybackNotification();
+}
+
+void USpotifyService::PostPlaybackNotification()
+{
+	if(PlaybackNotification == INDEX_NONE)
+	{
+		PlaybackNotification = WorkQueue.Register(ESpotifyWorkPriority::UserVisible, [this]() { NotifyPlayback(); });
+	}
+	WorkQueue.Post(PlaybackNotification);
+}
+
+void USpotifyService::NotifyPlayback()
+{
+	if(bPlaybackAdvancePending && Accounts.IsValidIndex(ActiveAccount))
+	{
+		const FSpotifyAccount& Account = Accounts[ActiveAccount];
+		OnPlaybackAdvancedDelegate.Broadcast(Account.PlaybackDuration, Account.PlaybackProgress);
+	}
+	bPlaybackAdvancePending = false;
+
+	const ESpotifyPlaybackFields Fields = PendingPlaybackFields;
+	PendingPlaybackFields = ESpotifyPlaybackFields::None;
+	if(Fields != ESpotifyPlaybackFields::None)
+	{
+		OnPlaybackChanged.Broadcast(Fields);
+	}
+}
+
+void USpotifyService::CloseListeningSpan(int32 AccountIndex, int64 NowMs)
+{
+	FSpotifyAccount& Account = Accounts[AccountIndex];
+	// Polls may have stopped for a while (e.g. a stuck request), don't count the gap as listening.
+	const int64 EndMs = FMath::Min(NowMs, Account.ListeningSeenAt + static_cast<int64>(StalePollTimeout * 1000.0));
+	if(Account.History.IsOpen() && Account.SongId.IsValid())
+	{
+		WorkQueue.Enqueue(ESpotifyWorkPriority::Background, [this, AccountIndex, StartMs = Account.ListeningSpanStart,
+			ListenedMs = static_cast<int32>(EndMs - Account.ListeningSpanStart), SongId = NamePool.Get(Account.SongId),
+			SongName = NamePool.Get(Account.SongName), Artist = Account.Artists.Num() > 0 ? NamePool.Get(Account.Artists[0]) : FString()]()
+		{
+			if(Accounts.IsValidIndex(AccountIndex))
+			{
+				Accounts[AccountIndex].History.RecordSpan(StartMs, ListenedMs, SongId, SongName, Artist);
+			}
+		});
+	}
+	Account.ListeningSpanStart = 0;
+}
+
+void USpotifyService::ReceiveAudioAnalysis(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful,
+	FString TrackId)
+{
+	if(!bWasSuccessful || Response->GetResponseCode() != 200)
+	{
+		PendingAnalyses.Remove(TrackId);
+		if(bWasSuccessful)
+		{
+			UE_LOG(LogSpotify, Warning, TEXT("No Audio Analysis for %s: %s"), *TrackId, *Response->GetContentAsString());
 		}
+		return;
 	}
-	if(Response->GetResponseCode() == 204)
+
+	// The analysis of a single track easily is a megabyte of JSON, decode and flatten it in one go on the worker.
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<USpotifyService>(this), Response, TrackId]()
 	{
-		UE_LOG(LogSpotify, Verbose, TEXT("Received Playback, no device playing or in private session."));
+		FSpotifyDecodeResult Result = FSpotifyResponseDecoder::Decode(Response);
+		TSharedPtr<const FSpotifyAudioAnalysis> Analysis;
+		if(Result.Json.IsValid())
+		{
+			Analysis = FSpotifyAudioAnalysis::Parse(*Result.Json);
+			Result.Json.Reset();
+		}
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, TrackId, Analysis, Result = MoveTemp(Result)]()
+		{
+			if(USpotifyService* This = WeakThis.Get())
+			{
+				This->TransferStats.Add(Result);
+				This->WorkQueue.Enqueue(ESpotifyWorkPriority::Normal, [This, TrackId, Analysis]()
+				{
+					This->AddAudioAnalysis(TrackId, Analysis);
+				});
+			}
+		});
+	});
+}
+
+void USpotifyService::AddAudioAnalysis(const FString& TrackId, TSharedPtr<const FSpotifyAudioAnalysis> Analysis)
+{
+	PendingAnalyses.Remove(TrackId);
+	if(!Analysis.IsValid()) return;
+
+	// A track already in the cache only moves to the back, so every cached track is in the order exactly once.
+	if(AnalysisCache.Contains(TrackId))
+	{
+		AnalysisCacheOrder.RemoveSingle(TrackId);
+	}
+	else if(AnalysisCacheOrder.Num() >= MaxCachedAnalyses)
+	{
+		AnalysisCache.Remove(AnalysisCacheOrder[0]);
+		AnalysisCacheOrder.RemoveAt(0);
+	}
+	AnalysisCache.Add(TrackId, Analysis);
+	AnalysisCacheOrder.Add(TrackId);
+
+	if(Accounts.IsValidIndex(ActiveAccount) && NamePool.Get(Accounts[ActiveAccount].SongId) == TrackId)
+	{
+		BeatCursor.Reset(Analysis);
 	}
 }
 
-void USpotifyService::ReceivePlay(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+void USpotifyService::ReceivePlaylistPage(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful,
+	TSharedPtr<FSpotifyPlaylistSync> Sync)
 {
-	if(!bWasSuccessful) return;
-	if(Response->GetResponseCode() == 204)
+	if(!bWasSuccessful || Response->GetResponseCode() != 200)
 	{
-		UE_LOG(LogSpotify, Verbose, TEXT("Request Successful."));
+		if(bWasSuccessful)
+		{
+			UE_LOG(LogSpotify, Error, TEXT("%s"), *Response->GetContentAsString());
+		}
+		FinishPlaylistSync(Sync, false);
+		return;
 	}
-	else if(Response->GetResponseCode() == 404)
+
+	DecodeResponseAsync(Response, [this, Sync](TSharedPtr<FJsonObject> ParsedResponse)
 	{
-		UE_LOG(LogSpotify, Error, TEXT("Device not Found"));
+		if(!ParsedResponse.IsValid())
+		{
+			FinishPlaylistSync(Sync, false);
+			return;
+		}
+		ApplyPlaylistPage(Sync, *ParsedResponse);
+	});
+}
+
+void USpotifyService::ApplyPlaylistPage(TSharedPtr<FSpotifyPlaylistSync> Sync, const FJsonObject& ParsedResponse)
+{
+	// The first page is wrapped inside the playlist object, every following one is the paging object itself.
+	const FJsonObject* Page = &ParsedResponse;
+	const TSharedPtr<FJsonObject>* Tracks;
+	if(ParsedResponse.TryGetObjectField("tracks", Tracks))
+	{
+		Sync->SnapshotId = ParsedResponse.GetStringField("snapshot_id");
+		Page = Tracks->Get();
+	}
+
+	for(const auto& Item : Page->GetArrayField("items"))
+	{
+		// Unavailable tracks come back as null but still take up a position.
+		const TSharedPtr<FJsonObject>* Track;
+		Sync->Current.Add(Item->AsObject()->TryGetObjectField("track", Track) ? (*Track)->GetStringField("uri") : FString());
+	}
+
+	FString Next;
+	if(Page->TryGetStringField("next", Next) && !Next.IsEmpty())
+	{
+		RequestPlaylistPage(Sync, CreateRequestForUrl(ESpotifyEndpoint::Playlist, &Accounts[Sync->Account], Next));
+		return;
+	}
+
+	// Diffing thousands of tracks is too much for the game thread.
+	Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<USpotifyService>(this), Sync]()
+	{
+		Sync->Mutations = FSpotifyPlaylistDiff::Compute(Sync->Current, Sync->Target);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Sync]()
+		{
+			if(USpotifyService* This = WeakThis.Get())
+			{
+				This->RequestPlaylistMutation(Sync);
+			}
+		});
+	});
+}
+
+void USpotifyService::ReceivePlaylistMutation(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful,
+	TSharedPtr<FSpotifyPlaylistSync> Sync)
+{
+	if(!bWasSuccessful || Response->GetResponseCode() < 200 || Response->GetResponseCode() >= 300)
+	{
+		if(bWasSuccessful)
+		{
+			UE_LOG(LogSpotify, Error, TEXT("%s"), *Response->GetContentAsString());
+		}
+		FinishPlaylistSync(Sync, false);
+		return;
+	}
+
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Response->GetContentAsString());
+	TSharedPtr<FJsonObject> ParsedResponse;
+	if(FJsonSerializer::Deserialize(JsonReader, ParsedResponse))
+	{
+		ParsedResponse->TryGetStringField("snapshot_id", Sync->SnapshotId);
 	}
-	else if(Response->GetResponseCode() == 403)
+
+	Sync->NextMutation++;
+	RequestPlaylistMutation(Sync);
+}
+
+void USpotifyService::ReceiveQueueItem(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful,
+	TSharedPtr<FSpotifyQueueBatch> Batch, int32 Index)
+{
+	// The batch was given up on while this was in flight.
+	if(!QueueBatches.Contains(Batch)) return;
+
+	QueueInFlight--;
+	const FSpotifyError Error = OnError(Response, bWasSuccessful, ESpotifyEndpoint::Queue);
+	if(Error.Code == ESpotifyError::RateLimited)
 	{
+		QueueRateLimiter.BlockFor(FPlatformTime::Seconds(), Error.RetryAfterSeconds);
+		if(Batch->Attempts[Index] < MaxQueueAttempts)
+		{
+			// Sent again before anything new, in order.
+			Batch->Retries.Add(Index);
+			Batch->Retries.Sort();
+			PumpQueue();
+			return;
+		}
+	}
+
+	Batch->Results[Index] = Error;
+	CompleteQueueItems(Batch);
+	PumpQueue();
+}
+
+void USpotifyService::CompleteQueueItems(TSharedPtr<FSpotifyQueueBatch> Batch)
+{
+	while(Batch->Results.IsValidIndex(Batch->NextToComplete) && Batch->Results[Batch->NextToComplete].IsSet())
+	{
+		const FSpotifyError& Error = Batch->Results[Batch->NextToComplete].GetValue();
+		if(!Error.IsOk() && Batch->FirstError.IsOk())
+		{
+			Batch->FirstError = Error;
+		}
+		if(Batch->OnItemCompleted)
+		{
+			Batch->OnItemCompleted(Batch->NextToComplete, Error);
+		}
+		Batch->NextToComplete++;
+	}
+
+	if(Batch->NextToComplete == Batch->Uris.Num())
+	{
+		QueueBatches.Remove(Batch);
+		Batch->Promise.SetValue(TSpotifyResult<void>{Batch->FirstError});
+	}
+}
+
+FSpotifyError USpotifyService::OnError(FHttpResponsePtr Response, bool bWasSuccessful, ESpotifyEndpoint Endpoint)
+{
+	const FSpotifyError Error = FSpotifyError::FromResponse(Response, bWasSuccessful, Endpoint);
+	switch(Error.Code)
+	{
+	case ESpotifyError::None:
+		UE_LOG(LogSpotify, Verbose, TEXT("Request Successful."));
+		break;
+	case ESpotifyError::ConnectionFailed:
+		UE_LOG(LogSpotify, Warning, TEXT("Request failed, no response."));
+		break;
+	case ESpotifyError::NoActiveDevice:
+		UE_LOG(LogSpotify, Error, TEXT("Device not Found"));
+		break;
+	case ESpotifyError::NonPremium:
 		UE_LOG(LogSpotify, Error, TEXT("User is Non-Premium"));
+		break;
+	default:
+		UE_LOG(LogSpotify, Error, TEXT("%d: %s"), Error.StatusCode, *Error.Message);
+		break;
 	}
-	else
+	return Error;
+}
+
+bool USpotifyService::SetActiveAccount(FName Account)
+{
+	const int32 AccountIndex = Accounts.IndexOfByPredicate([Account](const FSpotifyAccount& Other) { return Other.Name == Account; });
+	if(AccountIndex == INDEX_NONE) return false;
+	if(AccountIndex == ActiveAccount) return true;
+
+	ActiveAccount = AccountIndex;
+	// The song handles stay, so the running play span and the track history are untouched,
+	// the next poll of this account just fires the full update (and picks up its analysis).
+	Accounts[AccountIndex].bNeedsFullUpdate = true;
+	BeatCursor.Reset(nullptr);
+	BroadcastPlaybackChanged(ESpotifyPlaybackFields::All);
+	return true;
+}
+
+FName USpotifyService::GetActiveAccount() const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].Name : NAME_None;
+}
+
+TArray<FName> USpotifyService::GetAccounts() const
+{
+	TArray<FName> Names;
+	for(const FSpotifyAccount& Account : Accounts)
 	{
-		UE_LOG(LogSpotify, Error, TEXT("%s"), *Response->GetContentAsString());
+		Names.Add(Account.Name);
 	}
+	return Names;
 }
 
-void USpotifyService::OnError(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+FSpotifyHedgeStats USpotifyService::GetHedgeStats() const
 {
-	
+	return PlaybackHedging.GetStats();
+}
+
+FSpotifyTransferStats USpotifyService::GetTransferStats() const
+{
+	return TransferStats;
 }
 
+FSpotifyWorkQueueStats USpotifyService::GetWorkQueueStats() const
+{
+	return WorkQueue.GetStats();
+}
+
+void USpotifyService::QueueGameThreadWork(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work)
+{
+	WorkQueue.Enqueue(Priority, MoveTemp(Work));
+}
+
+float USpotifyService::GetPlaybackPosition() const
+{
+	if(!Accounts.IsValidIndex(ActiveAccount)) return 0.f;
+
+	const FSpotifyAccount& Account = Accounts[ActiveAccount];
+	const double Elapsed = Account.bPlaying ? FPlatformTime::Seconds() - Account.PlaybackSyncTime : 0.0;
+	return static_cast<float>(Account.PlaybackProgress / 1000.0 + Elapsed);
+}
+
+TArray<FSpotifyHistoryEntry> USpotifyService::GetTopTracks(FDateTime From, FDateTime To, int32 Count) const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].History.GetTopTracks(From, To, Count) : TArray<FSpotifyHistoryEntry>();
+}
+
+TArray<FSpotifyHistoryEntry> USpotifyService::GetTopArtists(FDateTime From, FDateTime To, int32 Count) const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].History.GetTopArtists(From, To, Count) : TArray<FSpotifyHistoryEntry>();
+}
+
+float USpotifyService::GetListeningTime(FDateTime From, FDateTime To) const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? static_cast<float>(Accounts[ActiveAccount].History.GetListeningSeconds(From, To)) : 0.f;
+}
+
+float USpotifyService::GetSkipRate(FDateTime From, FDateTime To) const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].History.GetSkipRate(From, To) : 0.f;
+}
+
+const FString& USpotifyService::GetSongName() const
+{
+	return NamePool.Get(Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].SongName : FSpotifyNameHandle());
+}
+
+const FString& USpotifyService::GetAlbumName() const
+{
+	return NamePool.Get(Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].AlbumName : FSpotifyNameHandle());
+}
+
+const FString& USpotifyService::GetAlbumImageUrl() const
+{
+	return NamePool.Get(Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].AlbumImageUrl : FSpotifyNameHandle());
+}
+
+FString USpotifyService::JoinArtistNames(const TCHAR* Separator) const
+{
+	FString Joined;
+	if(!Accounts.IsValidIndex(ActiveAccount)) return Joined;
+
+	for(const FSpotifyNameHandle& Artist : Accounts[ActiveAccount].Artists)
+	{
+		if(!Joined.IsEmpty())
+		{
+			Joined += Separator;
+		}
+		Joined += NamePool.Get(Artist);
+	}
+	return Joined;
+}
+
+int32 USpotifyService::GetPlaybackDuration() const
+{
+	return Accounts.IsValidIndex(ActiveAccount) ? Accounts[ActiveAccount].PlaybackDuration : 0;
+}
+
+bool USpotifyService::IsPlaying() const
+{
+	return Accounts.IsValidIndex(ActiveAccount) && Accounts[ActiveAccount].bPlaying;
+}
+
+TArray<float> USpotifyService::GetPitches() const
+{
+	return TArray<float>(BeatCursor.GetPitches());
+}
+
+TArray<float> USpotifyService::GetTimbre() const
+{
+	return TArray<float>(BeatCursor.GetTimbre());
+}
 
 void USpotifyService::Tick(float DeltaTime)
 {
 	TCPListener();
 	ConnectionListener();
+
+	TimerWheel.Advance(FPlatformTime::Seconds(), [this](uint64 Payload) { OnTimerExpired(Payload); });
+
+	if(BeatCursor.IsValid() && Accounts.IsValidIndex(ActiveAccount) && Accounts[ActiveAccount].bPlaying)
+	{
+		const FSpotifyBeatCursor::FCrossed Crossed = BeatCursor.Advance(GetPlaybackPosition());
+		if(Crossed.bSection) OnSectionDelegate.Broadcast(BeatCursor.GetSection());
+		if(Crossed.bBar) OnBarDelegate.Broadcast(BeatCursor.GetBar());
+		if(Crossed.bBeat) OnBeatDelegate.Broadcast(BeatCursor.GetBeat());
+	}
+
+	WorkQueue.Drain(WorkBudget);
 }
 
 bool USpotifyService::ShouldCreateSubsystem(UObject* Outer) const
@@ -380,23 +1417,68 @@ void USpotifyService::Initialize(FSubsystemCollectionBase& Collection)
 	ClientKey = Settings->ClientId;
 	RedirectURL = Settings->Callback;
 	SaveSlotName = Settings->SaveSlotName;
-	
-	if(LoadCredentials())
+	ApiBaseUrl = Settings->ApiBaseUrl;
+	ApiBaseUrl.RemoveFromEnd(TEXT("/"));
+	AccountsBaseUrl = Settings->AccountsBaseUrl;
+	AccountsBaseUrl.RemoveFromEnd(TEXT("/"));
+	RequestTemplates.Build(ApiBaseUrl, AccountsBaseUrl);
+	PollInterval = Settings->PollInterval;
+	PlaybackHedging.SetBudgetRatio(Settings->HedgeBudget);
+	QueueRateLimiter.Configure(Settings->QueueRequestsPerSecond, FMath::Max(1.f, Settings->QueueRequestsPerSecond));
+	QueueWindow = FMath::Max(1, Settings->QueueWindow);
+	WorkBudget = FMath::Max(1.f, Settings->WorkBudgetMicroseconds) / 1000000.0;
+
+	ActiveAccount = 0;
+	AuthorizingAccount = INDEX_NONE;
+	TimerWheel.Reset(FPlatformTime::Seconds());
+
+	// Open the connections now, so neither the first token refresh nor the first command pays for the handshake.
+	ConnectionWarmer.SetInterval(Settings->KeepAliveInterval);
+	ConnectionWarmer.WarmAll(RequestTemplates, FPlatformTime::Seconds(), [this](const FString& Url)
 	{
-		RefreshAccessKey();
-		return;
+		FSpotifyConnectionWarmer::Ping(*Http, Url);
+	});
+	KeepConnectionsAlive();
+
+	// Every account shares the one HTTP module (and with it its connection pool).
+	AddAccount(NAME_Default, SaveSlotName);
+	for(const FName& Account : Settings->AdditionalAccounts)
+	{
+		AddAccount(Account, FString::Printf(TEXT("%s_%s"), *SaveSlotName, *Account.ToString()));
 	}
-	
 
-	BeginAuthorization();
+	BeginNextAuthorization();
 }
 
 void USpotifyService::Deinitialize()
 {
-	if(!RefreshKey.IsEmpty() && !Verify.IsEmpty() && !Challenge.IsEmpty())
+	const int64 NowMs = FSpotifyListeningHistory::NowUnixMs();
+	for(int32 AccountIndex = 0; AccountIndex < Accounts.Num(); AccountIndex++)
 	{
-		SaveToSlot();
+		const FSpotifyAccount& Account = Accounts[AccountIndex];
+		if(Account.ListeningSpanStart != 0)
+		{
+			CloseListeningSpan(AccountIndex, NowMs);
+		}
+		if(!Account.RefreshKey.IsEmpty() && !Account.Verify.IsEmpty() && !Account.Challenge.IsEmpty())
+		{
+			SaveToSlot(Account);
+		}
+	}
+	// Nothing answers anymore, don't leave anyone waiting.
+	for(const TSharedPtr<FSpotifyQueueBatch>& Batch : QueueBatches)
+	{
+		Batch->Promise.SetValue(TSpotifyResult<void>{FSpotifyError::Make(ESpotifyError::ConnectionFailed)});
 	}
+	QueueBatches.Reset();
+	QueueInFlight = 0;
+	// Whatever is still deferred (history writes in particular) needs the accounts.
+	WorkQueue.Flush();
+	Accounts.Reset();
+	PendingAnalyses.Reset();
+	NamePool.Reset();
+	BeatCursor.Reset(nullptr);
+	TimerWheel.Reset(FPlatformTime::Seconds());
 	if(ConnectionSocket)
 	{
 		ConnectionSocket->Close();
@@ -409,3 +1491,12 @@ void USpotifyService::Deinitialize()
 	}
 	Super::Deinitialize();
 }
+
+#if WITH_DEV_AUTOMATION_TESTS
+int32 USpotifyService::AddTestAccount(FName Name)
+{
+	FSpotifyAccount& Account = Accounts.AddDefaulted_GetRef();
+	Account.Name = Name;
+	return Accounts.Num() - 1;
+}
+#endif
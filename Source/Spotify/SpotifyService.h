@@ -4,6 +4,18 @@
 
 #include "CoreMinimal.h" 
 #include "HttpModule.h"
+#include "SpotifyAccount.h"
+#include "SpotifyAudioAnalysis.h"
+#include "SpotifyConnectionWarmer.h"
+#include "SpotifyHedging.h"
+#include "SpotifyPlaylistDiff.h"
+#include "SpotifyQueue.h"
+#include "SpotifyRateLimiter.h"
+#include "SpotifyRequestTemplate.h"
+#include "SpotifyResponseDecoder.h"
+#include "SpotifyResult.h"
+#include "SpotifyWorkQueue.h"
+#include "Async/Future.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "SpotifyService.generated.h"
 
@@ -13,6 +25,33 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_SevenParams(FOnReceivePlaybackDataDelegate, F
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPlaybackAdvancedDelegate, int, Duration, int, Progress);
 
+// Params: Account, Song Name, isPlaying. Fired for every hosted account whenever its song changes.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnAccountSongChangedDelegate, FName, Account, FString, SongName, bool, isPlaying);
+
+// Params: Index of the Bar, Beat or Section that just started.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMusicEventDelegate, int, Index);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPlaylistSyncedDelegate, FString, PlaylistId, bool, bSuccess);
+
+// What changed about the playback of the active account.
+enum class ESpotifyPlaybackFields : uint8
+{
+	None = 0,
+	SongName = 1 << 0,
+	Artists = 1 << 1,
+	AlbumName = 1 << 2,
+	AlbumImage = 1 << 3,
+	PlayState = 1 << 4,
+	Duration = 1 << 5,
+	// The position jumped in a way the interpolated clock doesn't show (new song, or a seek while paused).
+	Position = 1 << 6,
+	All = 0x7F
+};
+ENUM_CLASS_FLAGS(ESpotifyPlaybackFields)
+
+// Native, only fired for the active account and only with the fields that actually changed.
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnSpotifyPlaybackChanged, ESpotifyPlaybackFields);
+
 /**
  * This Class handles the Spotify API
  * It has the same lifetime as a Game Instance (meaning it will persist between worlds)
@@ -24,9 +63,9 @@ class SPOTIFY_API USpotifyService : public UGameInstanceSubsystem, public FTicka
 
 protected:
 	
-	void SaveToSlot();
+	void SaveToSlot(const FSpotifyAccount& Account);
 
-	bool LoadCredentials();
+	bool LoadCredentials(FSpotifyAccount& Account);
 
 	UPROPERTY(Transient)
 	FString SaveSlotName;
@@ -35,6 +74,13 @@ protected:
 	UPROPERTY(Transient)
 	FString ClientKey;
 
+	// Base url of the Web API (without trailing slash).
+	UPROPERTY(Transient)
+	FString ApiBaseUrl;
+
+	UPROPERTY(Transient)
+	FString AccountsBaseUrl;
+
 	// Where a user should be redirected to after approving.
 	UPROPERTY(Transient)
 	FString RedirectURL;
@@ -43,27 +89,44 @@ protected:
 	UPROPERTY(Transient)
 	FString AuthKey;
 
-	// Access Key (the Key used for executing API calls).
-	UPROPERTY(Transient)
-	FString AccessKey;
+	// Every hosted account, the first one is the default account.
+	TArray<FSpotifyAccount> Accounts;
 
-	// This key wont run out, it is used to refresh the Access key once it runs out.
-	UPROPERTY(Transient)
-	FString RefreshKey;
+	// The account commands are sent to and playback delegates are fired for.
+	int32 ActiveAccount;
 
-	// For the Proof-Key-Challenge-Exchange (PKCE).
-	UPROPERTY(Transient)
-	FString Verify;
+	// The account currently going through the browser authorization (INDEX_NONE if none).
+	int32 AuthorizingAccount;
 
-	// The Auto-Generated Challenge for PKCE.
-	UPROPERTY(Transient)
-	FString Challenge;
+	// Accounts without saved credentials waiting for their turn to authorize.
+	TArray<int32> PendingAuthorizations;
 
-	UPROPERTY(Transient)
-	FDateTime AccessKeyExpiration;
+	// Song Ids and display names of every account.
+	FSpotifyNamePool NamePool;
+
+	// Every refresh and poll deadline of every account.
+	FSpotifyTimerWheel TimerWheel;
+
+	float PollInterval;
+
+	// Hedging of the playback info polls, shared by all accounts.
+	FSpotifyHedgePolicy PlaybackHedging;
+
+	// Compression and decode numbers of every response decoded through DecodeResponseAsync.
+	FSpotifyTransferStats TransferStats;
+
+	// A poll that hasn't answered after this many seconds is given up on.
+	static constexpr double StalePollTimeout = 10.0;
 	
 	FHttpModule* Http;
 
+	// Verb, url and fixed headers of every endpoint, built once in Initialize.
+	FSpotifyRequestTemplates RequestTemplates;
+
+	FSpotifyConnectionWarmer ConnectionWarmer;
+
+	FSpotifyTimerHandle KeepAliveTimer;
+
 	// This Socket listens for incoming connection on localhost:Port.
 	FSocket* ServerSocket;
 
@@ -73,13 +136,51 @@ protected:
 	// Whether or not we should listen on a pending connection.
 	bool bListening;
 
-	FTimerHandle AccessKeyExpireTimerHandle;
+	// Audio analysis of the most recently played tracks, keyed by Song Id (oldest first in AnalysisCacheOrder).
+	TMap<FString, TSharedPtr<const FSpotifyAudioAnalysis>> AnalysisCache;
 
-	FTimerHandle PlaybackInfoTimerHandle;
+	TArray<FString> AnalysisCacheOrder;
 
-	// Only call big update whenever song ID changes.
-	UPROPERTY(Transient)
-	FString SongId;
+	static constexpr int32 MaxCachedAnalyses = 8;
+
+	// Tracks whose analysis is being downloaded or parsed, so switching back and forth doesn't request it twice.
+	TSet<FString> PendingAnalyses;
+
+	// Follows the analysis of the current song along the interpolated playback clock.
+	FSpotifyBeatCursor BeatCursor;
+
+	// Running playlist synchronisations, keyed by Playlist Id.
+	TMap<FString, TSharedPtr<FSpotifyPlaylistSync>> PlaylistSyncs;
+
+	// Running bulk enqueues, oldest first. Only the oldest one sends so batches don't interleave.
+	TArray<TSharedPtr<FSpotifyQueueBatch>> QueueBatches;
+
+	FSpotifyRateLimiter QueueRateLimiter;
+
+	int32 QueueWindow;
+
+	int32 QueueInFlight = 0;
+
+	// Wakes the queue up once the rate limiter hands out tokens again.
+	FSpotifyTimerHandle QueuePumpTimer;
+
+	// A rate limited queue addition is sent at most this often.
+	static constexpr uint8 MaxQueueAttempts = 3;
+
+	// Deferred game thread work, drained in Tick within WorkBudget seconds.
+	FSpotifyWorkQueue WorkQueue;
+
+	double WorkBudget = 0.0005;
+
+	// Registered work that sends the playback notifications collected since it last ran.
+	int32 PlaybackNotification = INDEX_NONE;
+
+	ESpotifyPlaybackFields PendingPlaybackFields = ESpotifyPlaybackFields::None;
+
+	bool bPlaybackAdvancePending = false;
+
+	// Id of the last polled item, reused so reading it doesn't allocate.
+	FString PolledSongId;
 
 public:
 
@@ -88,14 +189,141 @@ public:
 
 	UPROPERTY(BlueprintAssignable)
 	FOnPlaybackAdvancedDelegate OnPlaybackAdvancedDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnAccountSongChangedDelegate OnAccountSongChangedDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnMusicEventDelegate OnBeatDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnMusicEventDelegate OnBarDelegate;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnMusicEventDelegate OnSectionDelegate;
+
+	// Makes Account receive all following commands and drive the playback delegates.
+	UFUNCTION(BlueprintCallable)
+	bool SetActiveAccount(FName Account);
+
+	UFUNCTION(BlueprintPure)
+	FName GetActiveAccount() const;
+
+	UFUNCTION(BlueprintPure)
+	TArray<FName> GetAccounts() const;
+
+	// How often playback info polls were hedged and what it did to their latency.
+	UFUNCTION(BlueprintPure)
+	FSpotifyHedgeStats GetHedgeStats() const;
+
+	// How many bytes went over the wire compared to the decoded responses and how long decoding took.
+	UFUNCTION(BlueprintPure)
+	FSpotifyTransferStats GetTransferStats() const;
+
+	// How much deferred game thread work ran and how often it had to wait for the next frame.
+	UFUNCTION(BlueprintPure)
+	FSpotifyWorkQueueStats GetWorkQueueStats() const;
+
+	// Runs Work on the game thread within the per frame work budget, for anything that isn't needed this very frame.
+	void QueueGameThreadWork(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work);
+
+	// Playback position in seconds, interpolated between polls.
+	UFUNCTION(BlueprintPure)
+	float GetPlaybackPosition() const;
+
+	// The 12 pitch classes of the current moment, interpolated between segments.
+	UFUNCTION(BlueprintPure)
+	TArray<float> GetPitches() const;
+
+	// The 12 timbre values of the current moment, interpolated between segments.
+	UFUNCTION(BlueprintPure)
+	TArray<float> GetTimbre() const;
+
+	// Most listened tracks of the active account between From and To (UTC), rounded to whole hours.
+	UFUNCTION(BlueprintPure)
+	TArray<FSpotifyHistoryEntry> GetTopTracks(FDateTime From, FDateTime To, int32 Count = 10) const;
+
+	UFUNCTION(BlueprintPure)
+	TArray<FSpotifyHistoryEntry> GetTopArtists(FDateTime From, FDateTime To, int32 Count = 10) const;
+
+	// Seconds the active account listened between From and To.
+	UFUNCTION(BlueprintPure)
+	float GetListeningTime(FDateTime From, FDateTime To) const;
+
+	// Share of the track changes between From and To that skipped the previous track.
+	UFUNCTION(BlueprintPure)
+	float GetSkipRate(FDateTime From, FDateTime To) const;
+
+	// Native access to what the active account plays, for views that update on OnPlaybackChanged.
+	FOnSpotifyPlaybackChanged OnPlaybackChanged;
+
+	const FString& GetSongName() const;
+
+	const FString& GetAlbumName() const;
+
+	const FString& GetAlbumImageUrl() const;
+
+	FString JoinArtistNames(const TCHAR* Separator = TEXT(", ")) const;
+
+	// Duration of the current song in milliseconds.
+	int32 GetPlaybackDuration() const;
+
+	bool IsPlaying() const;
+
+	// Allocation free access to the interpolated values for native code.
+	const FSpotifyBeatCursor& GetBeatCursor() const { return BeatCursor; }
+
+	// Called once a playlist synchronisation finished or failed.
+	UPROPERTY(BlueprintAssignable)
+	FOnPlaylistSyncedDelegate OnPlaylistSyncedDelegate;
+
+	/////////////////////////////////////////
+	// Awaitable Commands
+	// The futures are fulfilled on the game thread as soon as Spotify answered (or right away if the command
+	// couldn't be sent), so dependent commands can be chained with Next without waiting for the next poll.
+
+	TFuture<TSpotifyResult<void>> Play();
+
+	TFuture<TSpotifyResult<void>> Pause();
+
+	TFuture<TSpotifyResult<void>> SkipToNext();
+
+	TFuture<TSpotifyResult<void>> SkipToPrevious();
+
+	TFuture<TSpotifyResult<void>> SeekTo(int32 PositionMs);
+
+	TFuture<TSpotifyResult<void>> SetVolumePercent(int32 VolumePercent);
+
+	// Moves playback to DeviceId, bPlay starts playing there (otherwise the current play state is kept).
+	TFuture<TSpotifyResult<void>> TransferPlayback(const FString& DeviceId, bool bPlay);
+
+	// The devices the active account can play on.
+	TFuture<TSpotifyResult<TArray<FSpotifyDevice>>> GetDevices();
+
+	// Starts a context or a list of tracks at an offset and position, all in one request.
+	TFuture<TSpotifyResult<void>> StartPlayback(const FSpotifyPlayRequest& PlayRequest);
+
+	// Adds Uris to the queue of the active account. Additions are pipelined under the rate limiter, OnItemCompleted
+	// is called for every uri in order and the future holds the first error (in order) if any addition failed.
+	// With a QueueWindow above 1 (see USpotifyDevSettings) the tracks may end up in the queue in a different order.
+	TFuture<TSpotifyResult<void>> Enqueue(const TArray<FString>& Uris, TFunction<void(int32 Index, const FSpotifyError& Error)> OnItemCompleted = nullptr);
 	
 protected:
 
 #pragma region Authentication
 	
+	// Adds an account and loads its credentials, returns its index.
+	int32 AddAccount(FName Name, const FString& AccountSaveSlot);
+
 	// Start Auth Procedure.
 	UFUNCTION()
-	void BeginAuthorization();
+	void BeginAuthorization(int32 AccountIndex);
+
+	// Authorizes the next account that has no saved credentials.
+	void BeginNextAuthorization();
+
+	// The authorizing account is done (or gave up), moves on to the next one or stops listening for callbacks.
+	void FinishAuthorization();
 
 	// Creates the Server Socket.
 	FSocket* CreateServerSocket();
@@ -109,7 +337,22 @@ protected:
 	// Filter Auth key from HTTP Request.
 	void RetrieveAuthKey(FString HttpResponse);
 
-	void RefreshAccessKey();
+	void RefreshAccessKey(int32 AccountIndex);
+
+	// Dispatches an expired timer wheel entry.
+	void OnTimerExpired(uint64 Payload);
+
+	// The account commands go to, nullptr if it has no access key (yet).
+	const FSpotifyAccount* GetCommandAccount() const;
+
+	// Builds a request from the endpoint's template, authorized for Account (if any). Marks the host as warm.
+	FHttpRequestRef CreateRequest(ESpotifyEndpoint Endpoint, const FSpotifyAccount* Account, FStringView Suffix = FStringView());
+
+	// Same, for an absolute url handed out by the API (e.g. the next page of a list).
+	FHttpRequestRef CreateRequestForUrl(ESpotifyEndpoint Endpoint, const FSpotifyAccount* Account, const FString& Url);
+
+	// Pings idle hosts while an account can send commands and something plays, there is nothing to be quick for otherwise.
+	void KeepConnectionsAlive();
 
 #pragma endregion
 
@@ -118,18 +361,23 @@ protected:
 	// API Requests
 	
 	// Requests a new Refresh Key.
-	void RequestRefreshKey();
+	void RequestRefreshKey(int32 AccountIndex);
 	
 	// Requests Information about Playback. (Title, Artist, Duration, Progression, Volume etc...)
-	void RequestPlaybackInformation();
+	void RequestPlaybackInformation(int32 AccountIndex);
+
+	// Sends a single playback info request (the poll itself or its hedge).
+	FHttpRequestPtr SendPlaybackInformationRequest(int32 AccountIndex);
+
+	// The poll is slower than usual, duplicate it if the budget allows.
+	void HedgePlaybackInformation(int32 AccountIndex);
 
 	// Request the player to start or resume playback.
 	UFUNCTION(BlueprintCallable)
 	void RequestPlay();
 
-	void PlaybackRequest(const FString& Url, const FString& Verb);
-
-	void PlaybackRequest(const FString& Url, const FString& Verb, const FString& Body);
+	// Sends a player command for the active account, the future holds the classified answer.
+	TFuture<TSpotifyResult<void>> PlaybackRequest(ESpotifyEndpoint Endpoint, FStringView Suffix = FStringView(), const FString& Body = FString());
 
 	// Request the player to pause playback.
 	UFUNCTION(BlueprintCallable)
@@ -146,21 +394,77 @@ protected:
 
 	UFUNCTION(BlueprintCallable)
 	void SetVolume(float Val);
+
+	// Requests the audio analysis of a track (bars, beats, sections and segments).
+	void RequestAudioAnalysis(const FString& TrackId);
+
+	// Makes the playlist contain exactly TrackUris (in order), using as few batched requests as possible.
+	UFUNCTION(BlueprintCallable)
+	void SyncPlaylist(const FString& PlaylistId, const TArray<FString>& TrackUris);
+
+	// Sends the request for one page of the playlists current tracks.
+	void RequestPlaylistPage(TSharedPtr<FSpotifyPlaylistSync> Sync, const FHttpRequestRef& Request);
+
+	// Sends the next mutation of the edit script, chained on the last snapshot id.
+	void RequestPlaylistMutation(TSharedPtr<FSpotifyPlaylistSync> Sync);
+
+	void FinishPlaylistSync(TSharedPtr<FSpotifyPlaylistSync> Sync, bool bSuccess);
+
+	// Sends queue additions of the oldest batch as far as the window and the rate limiter allow.
+	void PumpQueue();
+
+	void SendQueueItem(TSharedPtr<FSpotifyQueueBatch> Batch, int32 Index);
 	
 	/////////////////////////////////////////
 	// API Responses
 
+	// Inflates and parses the response on a worker thread, then calls OnDecoded on the game thread (with null if it didn't parse).
+	void DecodeResponseAsync(FHttpResponsePtr Response, TFunction<void(TSharedPtr<FJsonObject>)> OnDecoded);
+
 	// Received the Refresh Key.
-	void ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	void ReceiveRefreshKey(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, int32 AccountIndex);
 
 	// When Playback info is received.
-	void ReceivePlaybackInformation(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	void ReceivePlaybackInformation(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, int32 AccountIndex);
 
-	// Whether the playback started or not.
-	void ReceivePlay(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	// Applies decoded playback info to the account and fires the delegates.
+	void ApplyPlaybackInformation(int32 AccountIndex, const FJsonObject& ParsedResponse);
 
-	// Handle common error messages.
-	void OnError(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful);
+	// Writes the running play span of the account to its history.
+	void CloseListeningSpan(int32 AccountIndex, int64 NowMs);
+
+	// Adds Fields to the pending playback notification. It is a single UserVisible work item: it runs after UserVisible
+	// work queued before it, ahead of Normal and Background work, and fields changed until then go out with it.
+	void BroadcastPlaybackChanged(ESpotifyPlaybackFields Fields);
+
+	// Queues the playback notification, doesn't allocate once it was queued before.
+	void PostPlaybackNotification();
+
+	// Fires OnPlaybackAdvanced and OnPlaybackChanged for what happened since the last notification.
+	void NotifyPlayback();
+
+	// Received an audio analysis, parses it off the game thread.
+	void ReceiveAudioAnalysis(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, FString TrackId);
+
+	// Puts a parsed analysis into the cache and starts following it if the track is still playing.
+	void AddAudioAnalysis(const FString& TrackId, TSharedPtr<const FSpotifyAudioAnalysis> Analysis);
+
+	// Received a page of the playlist, requests the next one or starts diffing.
+	void ReceivePlaylistPage(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TSharedPtr<FSpotifyPlaylistSync> Sync);
+
+	void ApplyPlaylistPage(TSharedPtr<FSpotifyPlaylistSync> Sync, const FJsonObject& ParsedResponse);
+
+	// A mutation was applied, continues with the next one.
+	void ReceivePlaylistMutation(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TSharedPtr<FSpotifyPlaylistSync> Sync);
+
+	// A queue addition was answered, retries it if it was rate limited.
+	void ReceiveQueueItem(FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful, TSharedPtr<FSpotifyQueueBatch> Batch, int32 Index);
+
+	// Reports the answered uris in order and finishes the batch once all are.
+	void CompleteQueueItems(TSharedPtr<FSpotifyQueueBatch> Batch);
+
+	// Handle common error messages, returns the error the response amounts to (None if it succeeded).
+	static FSpotifyError OnError(FHttpResponsePtr Response, bool bWasSuccessful, ESpotifyEndpoint Endpoint);
 
 #pragma endregion
 	
@@ -179,5 +483,14 @@ public:
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
 	// End of UGameInstanceSubsystem Interface
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// Test hooks: run what a poll does with a canned answer, without HTTP or an initialized subsystem.
+	int32 AddTestAccount(FName Name);
+
+	void ApplyTestPlayback(int32 AccountIndex, const FJsonObject& Playback) { ApplyPlaybackInformation(AccountIndex, Playback); }
+
+	void FlushWork() { WorkQueue.Flush(); }
+#endif
 	
 };
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyTimerWheel.h"
+
+FSpotifyTimerWheel::FSpotifyTimerWheel(double InTickSeconds)
+	: TickSeconds(InTickSeconds)
+{
+	Reset(0.0);
+}
+
+void FSpotifyTimerWheel::Reset(double NowSeconds)
+{
+	StartSeconds = NowSeconds;
+	CurrentTick = 0;
+	Entries.Reset();
+	FreeList = INDEX_NONE;
+	NumScheduled = 0;
+	for(int32& Head : Heads)
+	{
+		Head = INDEX_NONE;
+	}
+}
+
+FSpotifyTimerHandle FSpotifyTimerWheel::Schedule(double DelaySeconds, uint64 Payload)
+{
+	int32 Index = FreeList;
+	if(Index != INDEX_NONE)
+	{
+		FreeList = Entries[Index].Next;
+	}
+	else
+	{
+		Index = Entries.AddDefaulted();
+	}
+
+	// Never schedule into the tick that is currently being processed.
+	const uint64 Delay = static_cast<uint64>(FMath::CeilToDouble(FMath::Max(0.0, DelaySeconds) / TickSeconds));
+	FEntry& Entry = Entries[Index];
+	Entry.Deadline = CurrentTick + FMath::Max<uint64>(Delay, 1);
+	Entry.Payload = Payload;
+	NumScheduled++;
+	Insert(Index);
+
+	FSpotifyTimerHandle Handle;
+	Handle.Index = Index;
+	Handle.Serial = Entry.Serial;
+	return Handle;
+}
+
+void FSpotifyTimerWheel::Cancel(FSpotifyTimerHandle& Handle)
+{
+	if(IsScheduled(Handle))
+	{
+		Unlink(Handle.Index);
+		Release(Handle.Index);
+	}
+	Handle.Invalidate();
+}
+
+bool FSpotifyTimerWheel::IsScheduled(const FSpotifyTimerHandle& Handle) const
+{
+	return Entries.IsValidIndex(Handle.Index) && Entries[Handle.Index].Serial == Handle.Serial && Entries[Handle.Index].Slot != INDEX_NONE;
+}
+
+void FSpotifyTimerWheel::Insert(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	const uint64 Delta = Entry.Deadline > CurrentTick ? Entry.Deadline - CurrentTick : 0;
+
+	int32 Level = 0;
+	while(Level < NumLevels - 1 && Delta >= (uint64(1) << ((Level + 1) * SlotBits)))
+	{
+		Level++;
+	}
+
+	// Anything beyond the wheels range waits in the last slot of the top level and is re-inserted from there.
+	const uint64 Range = uint64(1) << (NumLevels * SlotBits);
+	const uint64 SlotTick = Delta >= Range ? CurrentTick + Range - 1 : Entry.Deadline;
+
+	const int32 Slot = Level * SlotsPerLevel + static_cast<int32>((SlotTick >> (Level * SlotBits)) & SlotMask);
+	Entry.Slot = Slot;
+	Entry.Prev = INDEX_NONE;
+	Entry.Next = Heads[Slot];
+	if(Entry.Next != INDEX_NONE)
+	{
+		Entries[Entry.Next].Prev = Index;
+	}
+	Heads[Slot] = Index;
+}
+
+void FSpotifyTimerWheel::Unlink(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	if(Entry.Prev != INDEX_NONE)
+	{
+		Entries[Entry.Prev].Next = Entry.Next;
+	}
+	else
+	{
+		Heads[Entry.Slot] = Entry.Next;
+	}
+	if(Entry.Next != INDEX_NONE)
+	{
+		Entries[Entry.Next].Prev = Entry.Prev;
+	}
+	Entry.Slot = INDEX_NONE;
+}
+
+void FSpotifyTimerWheel::Release(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	Entry.Serial++;
+	Entry.Next = FreeList;
+	FreeList = Index;
+	NumScheduled--;
+}
+
+void FSpotifyTimerWheel::Cascade(int32 Level)
+{
+	const int32 Slot = Level * SlotsPerLevel + static_cast<int32>((CurrentTick >> (Level * SlotBits)) & SlotMask);
+	while(Heads[Slot] != INDEX_NONE)
+	{
+		const int32 Index = Heads[Slot];
+		Unlink(Index);
+		Insert(Index);
+	}
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSpotifyTimerHandle
+{
+	int32 Index = INDEX_NONE;
+	uint32 Serial = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; }
+};
+
+/**
+ * A hierarchical timer wheel (4 levels of 64 slots) used for every refresh and poll deadline of the service.
+ * Scheduling and cancelling are O(1) and never touch the engine timer manager, advancing costs one slot per tick
+ * plus the occasional cascade of a higher level, no matter how many timers (or accounts) there are.
+ * Timers carry a plain payload instead of a delegate so scheduling doesn't allocate once the pool has grown.
+ */
+class SPOTIFY_API FSpotifyTimerWheel
+{
+public:
+
+	explicit FSpotifyTimerWheel(double InTickSeconds = 0.01);
+
+	// Starts counting from Now (seconds), drops every scheduled timer.
+	void Reset(double NowSeconds);
+
+	// Fires Payload after DelaySeconds (rounded up to the next tick).
+	FSpotifyTimerHandle Schedule(double DelaySeconds, uint64 Payload);
+
+	// Removes the timer if it is still scheduled and invalidates the handle.
+	void Cancel(FSpotifyTimerHandle& Handle);
+
+	bool IsScheduled(const FSpotifyTimerHandle& Handle) const;
+
+	int32 Num() const { return NumScheduled; }
+
+	// Advances the wheel to Now (seconds) and calls OnExpired(Payload) for every due timer.
+	// OnExpired may schedule and cancel timers.
+	template<typename FuncType>
+	void Advance(double NowSeconds, FuncType&& OnExpired)
+	{
+		const uint64 TargetTick = static_cast<uint64>(FMath::Max(0.0, NowSeconds - StartSeconds) / TickSeconds);
+		while(CurrentTick < TargetTick)
+		{
+			CurrentTick++;
+			for(int32 Level = 1; Level < NumLevels && (CurrentTick & ((uint64(1) << (Level * SlotBits)) - 1)) == 0; Level++)
+			{
+				Cascade(Level);
+			}
+
+			// Pop one at a time, callbacks may cancel other timers of the same slot.
+			const int32 Slot = static_cast<int32>(CurrentTick & SlotMask);
+			while(Heads[Slot] != INDEX_NONE)
+			{
+				const int32 Index = Heads[Slot];
+				const uint64 Payload = Entries[Index].Payload;
+				Unlink(Index);
+				Release(Index);
+				OnExpired(Payload);
+			}
+		}
+	}
+
+private:
+
+	static constexpr int32 NumLevels = 4;
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotsPerLevel = 1 << SlotBits;
+	static constexpr uint64 SlotMask = SlotsPerLevel - 1;
+
+	struct FEntry
+	{
+		uint64 Deadline = 0;
+		uint64 Payload = 0;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+		// Slot (Level * SlotsPerLevel + Slot) the entry is linked into, INDEX_NONE while free.
+		int32 Slot = INDEX_NONE;
+		uint32 Serial = 0;
+	};
+
+	void Insert(int32 Index);
+
+	void Unlink(int32 Index);
+
+	void Release(int32 Index);
+
+	// Moves every entry of the current slot of Level down to the lower levels.
+	void Cascade(int32 Level);
+
+	double TickSeconds;
+
+	double StartSeconds = 0.0;
+
+	uint64 CurrentTick = 0;
+
+	TArray<FEntry> Entries;
+
+	int32 FreeList = INDEX_NONE;
+
+	int32 NumScheduled = 0;
+
+	int32 Heads[NumLevels * SlotsPerLevel];
+};
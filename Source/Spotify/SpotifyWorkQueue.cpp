@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpotifyWorkQueue.h"
+#include "Spotify.h"
+
+DECLARE_CYCLE_STAT(TEXT("Work Queue"), STAT_SpotifyWorkQueue, STATGROUP_Spotify);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Work Items Run"), STAT_SpotifyWorkItemsRun, STATGROUP_Spotify);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Work Items Deferred"), STAT_SpotifyWorkItemsDeferred, STATGROUP_Spotify);
+
+void FSpotifyWorkQueue::Enqueue(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work)
+{
+	Add(Priority, FItem{MoveTemp(Work), FPlatformTime::Seconds()});
+}
+
+int32 FSpotifyWorkQueue::Register(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work)
+{
+	FRegistration& Registration = Registrations.AddDefaulted_GetRef();
+	Registration.Work = MoveTemp(Work);
+	Registration.Priority = Priority;
+	return Registrations.Num() - 1;
+}
+
+void FSpotifyWorkQueue::Post(int32 Registration)
+{
+	FRegistration& Registered = Registrations[Registration];
+	if(Registered.bQueued) return;
+
+	Registered.bQueued = true;
+	Add(Registered.Priority, FItem{nullptr, FPlatformTime::Seconds(), Registration});
+}
+
+void FSpotifyWorkQueue::Add(ESpotifyWorkPriority Priority, FItem&& Item)
+{
+	check(IsInGameThread());
+	// Consumed lists keep their allocation, so in steady state this doesn't allocate.
+	Items[static_cast<int32>(Priority)].Add(MoveTemp(Item));
+	Pending++;
+	Stats.Pending = Pending;
+	Stats.MaxPending = FMath::Max(Stats.MaxPending, Pending);
+}
+
+void FSpotifyWorkQueue::Drain(double BudgetSeconds)
+{
+	if(Pending == 0)
+	{
+		Stats.LastDrainMs = 0.f;
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_SpotifyWorkQueue);
+
+	const double Start = FPlatformTime::Seconds();
+	double Now = Start;
+	do
+	{
+		const double ItemStart = Now;
+		if(!RunNext()) break;
+		Now = FPlatformTime::Seconds();
+		if(Now - ItemStart > BudgetSeconds)
+		{
+			Stats.Overruns++;
+		}
+	}
+	while(Now - Start < BudgetSeconds);
+
+	if(Pending > 0)
+	{
+		Stats.DeferredFrames++;
+	}
+	Stats.Pending = Pending;
+	Stats.LastDrainMs = static_cast<float>((Now - Start) * 1000.0);
+	Stats.MaxDrainMs = FMath::Max(Stats.MaxDrainMs, Stats.LastDrainMs);
+	SET_DWORD_STAT(STAT_SpotifyWorkItemsDeferred, Pending);
+}
+
+void FSpotifyWorkQueue::Flush()
+{
+	// Work may queue more work, run until it settles.
+	while(RunNext())
+	{
+	}
+	Stats.Pending = Pending;
+	SET_DWORD_STAT(STAT_SpotifyWorkItemsDeferred, 0);
+}
+
+bool FSpotifyWorkQueue::RunNext()
+{
+	for(int32 Priority = 0; Priority < static_cast<int32>(ESpotifyWorkPriority::Num); Priority++)
+	{
+		TArray<FItem>& List = Items[Priority];
+		int32& Head = Heads[Priority];
+		if(Head >= List.Num()) continue;
+
+		// Moved out first, the work may queue more and grow the list.
+		FItem Item = MoveTemp(List[Head]);
+		Head++;
+		if(Head == List.Num())
+		{
+			List.Reset();
+			Head = 0;
+		}
+		else if(Head >= 64 && Head * 2 >= List.Num())
+		{
+			List.RemoveAt(0, Head, false);
+			Head = 0;
+		}
+		Pending--;
+
+		const double Now = FPlatformTime::Seconds();
+		Stats.MaxWaitMs = FMath::Max(Stats.MaxWaitMs, static_cast<float>((Now - Item.QueuedAt) * 1000.0));
+		Stats.ItemsRun++;
+		INC_DWORD_STAT(STAT_SpotifyWorkItemsRun);
+
+		if(Item.Registration != INDEX_NONE)
+		{
+			FRegistration& Registered = Registrations[Item.Registration];
+			Registered.bQueued = false;
+			Registered.Work();
+		}
+		else
+		{
+			Item.Work();
+		}
+		return true;
+	}
+	return false;
+}
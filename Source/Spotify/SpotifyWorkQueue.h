@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpotifyWorkQueue.generated.h"
+
+// Order in which queued game thread work runs, what the player sees goes first.
+enum class ESpotifyWorkPriority : uint8
+{
+	UserVisible,
+	Normal,
+	Background,
+	Num
+};
+
+USTRUCT(BlueprintType)
+struct SPOTIFY_API FSpotifyWorkQueueStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ItemsRun = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Pending = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 MaxPending = 0;
+
+	// Frames that ran out of budget and left work for the next frame.
+	UPROPERTY(BlueprintReadOnly)
+	int32 DeferredFrames = 0;
+
+	// Single items that took longer than the whole budget on their own.
+	UPROPERTY(BlueprintReadOnly)
+	int32 Overruns = 0;
+
+	// Longest an item waited in the queue, in milliseconds.
+	UPROPERTY(BlueprintReadOnly)
+	float MaxWaitMs = 0.f;
+
+	// Time spent draining in the last frame and the worst frame, in milliseconds.
+	UPROPERTY(BlueprintReadOnly)
+	float LastDrainMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	float MaxDrainMs = 0.f;
+};
+
+/**
+ * Game thread work that doesn't have to happen the moment its data arrived (broadcasts, texture uploads, cache and
+ * history writes). Drain runs it in priority order, first in first out within a priority, until the frame's budget
+ * is used up and leaves the rest for the next frame. At least one item runs per drain, so nothing waits forever
+ * behind a budget that is smaller than a single item. Game thread only.
+ */
+class SPOTIFY_API FSpotifyWorkQueue
+{
+public:
+
+	void Enqueue(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work);
+
+	// Work that is queued over and over (like the playback notification of every poll) is registered once.
+	// Posting it doesn't allocate, posting it again before it ran is a no-op. Don't register from inside Drain.
+	int32 Register(ESpotifyWorkPriority Priority, TUniqueFunction<void()> Work);
+
+	void Post(int32 Registration);
+
+	void Drain(double BudgetSeconds);
+
+	// Runs everything that is queued regardless of the budget, for shutdown.
+	void Flush();
+
+	int32 Num() const { return Pending; }
+
+	const FSpotifyWorkQueueStats& GetStats() const { return Stats; }
+
+private:
+
+	struct FItem
+	{
+		TUniqueFunction<void()> Work;
+
+		// FPlatformTime::Seconds when it was queued.
+		double QueuedAt = 0.0;
+
+		// Index into Registrations if this runs registered work instead of Work.
+		int32 Registration = INDEX_NONE;
+	};
+
+	struct FRegistration
+	{
+		TUniqueFunction<void()> Work;
+
+		ESpotifyWorkPriority Priority = ESpotifyWorkPriority::Normal;
+
+		bool bQueued = false;
+	};
+
+	void Add(ESpotifyWorkPriority Priority, FItem&& Item);
+
+	// Runs the next item of the most important non-empty priority, false if there is none.
+	bool RunNext();
+
+	// Each priority is a first in first out list that is consumed from Heads and compacted once mostly consumed.
+	TArray<FItem> Items[static_cast<int32>(ESpotifyWorkPriority::Num)];
+
+	int32 Heads[static_cast<int32>(ESpotifyWorkPriority::Num)] = {};
+
+	TArray<FRegistration> Registrations;
+
+	int32 Pending = 0;
+
+	FSpotifyWorkQueueStats Stats;
+};